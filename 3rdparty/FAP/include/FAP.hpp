@@ -3,13 +3,27 @@
 #include "FAP/Unit.hpp"
 
 #include <vector>
+#include <algorithm>
 
 #define TANK_SPLASH_INNER_RADIUS_SQAURED 100
 #define TANK_SPLASH_MEDIAN_RADIUS_SQAURED 625
 #define TANK_SPLASH_OUTER_RADIUS_SQAURED 1600
 
+// Target acquisition uses an index of the enemy unit positions when the enemy has at least this many units
+// Below this, building the index each frame costs more than scanning the units directly
+#define TARGET_INDEX_MIN_UNITS 32
+
+// The index uses a grid of spatial bins when the enemy has at least this many units
+// Below this, the enemy units are put in a single bin, as spreading them over a grid costs more than scanning them all
+#define TARGET_BINS_MIN_UNITS 64
+#define TARGET_BIN_SIZE_SHIFT 8 // 256 pixels, about the longest weapon range
+
 namespace FAP
 {
+    // The target index thresholds, which tests lower or raise to check the index gives the same results as the linear scan
+    inline size_t targetIndexMinUnits = TARGET_INDEX_MIN_UNITS;
+    inline size_t targetBinsMinUnits = TARGET_BINS_MIN_UNITS;
+
     template<typename T = std::tuple<>>
     auto makeUnit()
     {
@@ -111,6 +125,39 @@ namespace FAP
 
         bool didSomething = false;
 
+        // Index of a player's units, used by the other player's units to find their targets
+        // The id index is rebuilt when units are added or removed. The bins are rebuilt at most once per frame when needed:
+        // units don't move while the other player's units are simulated, so the bins stay valid for the rest of the frame.
+        struct TargetIndex
+        {
+            bool idsValid = false;
+            std::vector<std::pair<int, int>> idToIndex; // Sorted by id, then index
+
+            bool binsValid = false;
+            int minX = 0;
+            int minY = 0;
+            int binsX = 0;
+            int binsY = 0;
+            std::vector<int> binStart;
+            std::vector<int> binNext;
+
+            // Binned units in structure-of-arrays form, so distances to a run of bins can be computed in one vectorized sweep
+            std::vector<int> unitX;
+            std::vector<int> unitY;
+            std::vector<int> unitIndex;
+            std::vector<int> distances;
+        };
+
+        TargetIndex player1Targets, player2Targets;
+
+        void invalidateTargetIndexes();
+
+        static void indexTargetIds(TargetIndex &index, std::vector<FAPUnit<UnitExtension>> &units);
+
+        static void binTargets(TargetIndex &index, std::vector<FAPUnit<UnitExtension>> &units);
+
+        static int distancesSquared(const int *xs, const int *ys, int count, int x, int y, int *out);
+
         static void dealDamage(FAPUnit<UnitExtension> &fu, int damage, BWAPI::DamageType damageType, FAPUnit<UnitExtension> &attacker);
 
         template<bool choke = false>
@@ -127,6 +174,7 @@ namespace FAP
                 FAPUnit<UnitExtension> &fu,
                 std::vector<FAPUnit<UnitExtension>> &friendlyUnits,
                 std::vector<FAPUnit<UnitExtension>> &enemyUnits,
+                TargetIndex &enemyTargets,
                 std::vector<unsigned char> &collision);
 
         void medicsim(FAPUnit<UnitExtension> &fu, std::vector<FAPUnit<UnitExtension>> &friendlyUnits);
@@ -144,6 +192,15 @@ namespace FAP
                 std::vector<FAPUnit<UnitExtension>> &itsFriendlies,
                 std::vector<FAPUnit<UnitExtension>> &itsEnemies);
 
+        // Releases the marines of a dead bunker as units of their own
+        static void bunkerDeath(
+                FAPUnit<UnitExtension> &&fu,
+                std::vector<FAPUnit<UnitExtension>> &itsFriendlies);
+
+        // Scratch buffers for the units that died in a frame
+        std::vector<FAPUnit<UnitExtension>> killed;
+        std::vector<int> killedIds;
+
         static auto max(int a, int b)
         {
             int vars[2] = {a, b};
@@ -210,6 +267,7 @@ namespace FAP
         initializeCollision<choke>(fu.unit, collisionPlayer1);
         fu.unit.player = 1;
         player1.emplace_back(fu.unit);
+        invalidateTargetIndexes();
     }
 
     template<typename UnitExtension>
@@ -220,6 +278,7 @@ namespace FAP
         initializeCollision<choke>(fu.unit, collisionPlayer2);
         fu.unit.player = 2;
         player2.emplace_back(fu.unit);
+        invalidateTargetIndexes();
     }
 
     template<typename UnitExtension>
@@ -254,6 +313,7 @@ namespace FAP
     void FastAPproximation<UnitExtension>::clear()
     {
         player1.clear(), player2.clear();
+        invalidateTargetIndexes();
         std::fill(collisionPlayer1.begin(), collisionPlayer1.end(), 0);
         std::fill(collisionPlayer2.begin(), collisionPlayer2.end(), 0);
     }
@@ -506,12 +566,117 @@ namespace FAP
         fu.cell = cell;
     }
 
+    template<typename UnitExtension>
+    void FastAPproximation<UnitExtension>::invalidateTargetIndexes()
+    {
+        player1Targets.idsValid = player1Targets.binsValid = false;
+        player2Targets.idsValid = player2Targets.binsValid = false;
+    }
+
+    template<typename UnitExtension>
+    void FastAPproximation<UnitExtension>::indexTargetIds(TargetIndex &index, std::vector<FAPUnit<UnitExtension>> &units)
+    {
+        index.idToIndex.clear();
+        for (int i = 0; i < (int)units.size(); i++)
+        {
+            index.idToIndex.emplace_back(units[i].id, i);
+        }
+        std::sort(index.idToIndex.begin(), index.idToIndex.end());
+        index.idsValid = true;
+    }
+
+    template<typename UnitExtension>
+    void FastAPproximation<UnitExtension>::binTargets(TargetIndex &index, std::vector<FAPUnit<UnitExtension>> &units)
+    {
+        // Dead and undetected units can't be targeted, and dead units can't come back while the bins are valid,
+        // so they are left out
+        auto targetable = [](const FAPUnit<UnitExtension> &unit)
+        {
+            return unit.health > 0 && !unit.undetected;
+        };
+
+        // Small sims use a single bin, which is scanned in full
+        bool singleBin = units.size() < targetBinsMinUnits;
+
+        int maxX = INT_MIN, maxY = INT_MIN;
+        index.minX = INT_MAX;
+        index.minY = INT_MAX;
+        if (!singleBin)
+        {
+            for (auto &unit : units)
+            {
+                if (!targetable(unit)) continue;
+                index.minX = std::min(index.minX, unit.x);
+                index.minY = std::min(index.minY, unit.y);
+                maxX = std::max(maxX, unit.x);
+                maxY = std::max(maxY, unit.y);
+            }
+        }
+        if (maxX == INT_MIN)
+        {
+            index.minX = index.minY = maxX = maxY = 0;
+        }
+        index.binsX = ((maxX - index.minX) >> TARGET_BIN_SIZE_SHIFT) + 1;
+        index.binsY = ((maxY - index.minY) >> TARGET_BIN_SIZE_SHIFT) + 1;
+
+        // Counting sort of the units into bins, which are ordered by row so a run of bins in a row is contiguous
+        auto binOf = [&index, singleBin](const FAPUnit<UnitExtension> &unit)
+        {
+            if (singleBin) return 0;
+            return ((unit.x - index.minX) >> TARGET_BIN_SIZE_SHIFT) + ((unit.y - index.minY) >> TARGET_BIN_SIZE_SHIFT) * index.binsX;
+        };
+        index.binStart.assign(index.binsX * index.binsY + 1, 0);
+        for (auto &unit : units)
+        {
+            if (targetable(unit)) index.binStart[binOf(unit) + 1]++;
+        }
+        for (size_t i = 1; i < index.binStart.size(); i++)
+        {
+            index.binStart[i] += index.binStart[i - 1];
+        }
+
+        int count = index.binStart.back();
+        index.unitX.resize(count);
+        index.unitY.resize(count);
+        index.unitIndex.resize(count);
+        index.distances.resize(count);
+        index.binNext.assign(index.binStart.begin(), index.binStart.end() - 1);
+        for (int i = 0; i < (int)units.size(); i++)
+        {
+            auto &unit = units[i];
+            if (!targetable(unit)) continue;
+            int position = index.binNext[binOf(unit)]++;
+            index.unitX[position] = unit.x;
+            index.unitY[position] = unit.y;
+            index.unitIndex[position] = i;
+        }
+
+        index.binsValid = true;
+    }
+
+    // Writes the squared distances from (x, y) to each of the positions and returns the smallest
+    // This is kept branch-free so the compiler can vectorize it
+    template<typename UnitExtension>
+    int FastAPproximation<UnitExtension>::distancesSquared(const int *xs, const int *ys, int count, int x, int y, int *out)
+    {
+        int result = INT_MAX;
+        for (int i = 0; i < count; i++)
+        {
+            int dx = xs[i] - x;
+            int dy = ys[i] - y;
+            out[i] = dx * dx + dy * dy;
+            result = out[i] < result ? out[i] : result;
+        }
+        return result;
+    }
+
     template<typename UnitExtension>
     template<bool tankSplash, bool choke>
     void FastAPproximation<UnitExtension>::unitsim(
             FAPUnit<UnitExtension> &fu,
             std::vector<FAPUnit<UnitExtension>> &friendlyUnits,
             std::vector<FAPUnit<UnitExtension>> &enemyUnits,
+            TargetIndex &enemyTargets,
             std::vector<unsigned char> &collision)
     {
         bool kite = false;
@@ -542,9 +707,16 @@ namespace FAP
         int currentTargetDist = INT_MAX;
         if (fu.target)
         {
-            for (auto enemyIt = enemyUnits.begin(); enemyIt != enemyUnits.end(); ++enemyIt)
+            if (!enemyTargets.idsValid) indexTargetIds(enemyTargets, enemyUnits);
+
+            // Units can share an id (marines coming out of a dead bunker), in which case we take the first live one
+            auto idIt = std::lower_bound(enemyTargets.idToIndex.begin(),
+                                         enemyTargets.idToIndex.end(),
+                                         std::make_pair(fu.target, INT_MIN));
+            for (; idIt != enemyTargets.idToIndex.end() && idIt->first == fu.target; ++idIt)
             {
-                if (enemyIt->health > 0 && enemyIt->id == fu.target)
+                auto enemyIt = enemyUnits.begin() + idIt->second;
+                if (enemyIt->health > 0)
                 {
                     currentTarget = enemyIt;
                     currentTargetDist = distSquared(fu, *enemyIt);
@@ -565,30 +737,112 @@ namespace FAP
         if (closestEnemy == enemyUnits.end() ||
             (closestDistSquared > (closestEnemy->flying ? fu.airMaxRangeSquared : fu.groundMaxRangeSquared) && !kite))
         {
-            for (auto enemyIt = enemyUnits.begin(); enemyIt != enemyUnits.end(); ++enemyIt)
+            // Distances through a choke aren't euclidean, so ground units simulated in a choke always scan linearly
+            if ((!choke || fu.flying) && enemyUnits.size() >= targetIndexMinUnits)
             {
-                if (enemyIt->health < 1 || enemyIt->undetected || enemyIt == currentTarget) continue;
-                if (enemyIt->flying)
+                auto &index = enemyTargets;
+                if (!index.binsValid) binTargets(index, enemyUnits);
+
+                // Distances to all units in the bins are computed in one sweep, and the bins are skipped if none are closer
+                // Ties are resolved to the enemy first in the vector, giving the same result as the linear scan
+                auto considerBins = [&](int firstBin, int lastBin)
                 {
-                    if (fu.airDamage)
+                    int first = index.binStart[firstBin];
+                    int count = index.binStart[lastBin + 1] - first;
+                    if (count == 0) return;
+
+                    int *distances = index.distances.data() + first;
+                    if (distancesSquared(index.unitX.data() + first, index.unitY.data() + first, count, fu.x, fu.y, distances)
+                        > closestDistSquared)
                     {
-                        auto const d = distSquared<choke>(fu, *enemyIt);
-                        if (d < closestDistSquared && d >= fu.airMinRangeSquared)
+                        return;
+                    }
+
+                    for (int i = 0; i < count; i++)
+                    {
+                        auto const d = distances[i];
+                        if (d > closestDistSquared) continue;
+
+                        auto enemyIt = enemyUnits.begin() + index.unitIndex[first + i];
+                        if (d == closestDistSquared && (closestEnemy == currentTarget || enemyIt > closestEnemy)) continue;
+                        if (enemyIt->health < 1 || enemyIt == currentTarget) continue;
+                        if (enemyIt->flying)
+                        {
+                            if (!fu.airDamage || d < fu.airMinRangeSquared) continue;
+                        }
+                        else
                         {
-                            closestDistSquared = d;
-                            closestEnemy = enemyIt;
+                            if (!fu.groundDamage || d < fu.groundMinRangeSquared) continue;
                         }
+
+                        closestDistSquared = d;
+                        closestEnemy = enemyIt;
                     }
+                };
+
+                if (index.binsX == 1 && index.binsY == 1)
+                {
+                    considerBins(0, 0);
                 }
                 else
                 {
-                    if (fu.groundDamage)
+                    // Search rings of bins outwards from the unit's bin
+                    // Units outside ring r are more than (r - 1) bins away, so we can stop once we have found an enemy closer than that
+                    int binX = (fu.x - index.minX) >> TARGET_BIN_SIZE_SHIFT;
+                    int binY = (fu.y - index.minY) >> TARGET_BIN_SIZE_SHIFT;
+                    int maxRing = std::max(std::max(binX, index.binsX - 1 - binX), std::max(binY, index.binsY - 1 - binY));
+                    for (int ring = 0; ring <= maxRing; ring++)
                     {
-                        auto const d = distSquared<choke>(fu, *enemyIt);
-                        if (d < closestDistSquared && d >= fu.groundMinRangeSquared)
+                        if (ring > 0)
                         {
-                            closestDistSquared = d;
-                            closestEnemy = enemyIt;
+                            int minDist = (ring - 1) << TARGET_BIN_SIZE_SHIFT;
+                            if (closestDistSquared <= minDist * minDist) break;
+                        }
+
+                        for (int y = std::max(binY - ring, 0); y <= std::min(binY + ring, index.binsY - 1); y++)
+                        {
+                            int row = y * index.binsX;
+                            if (y == binY - ring || y == binY + ring)
+                            {
+                                int firstX = std::max(binX - ring, 0);
+                                int lastX = std::min(binX + ring, index.binsX - 1);
+                                if (firstX <= lastX) considerBins(row + firstX, row + lastX);
+                                continue;
+                            }
+
+                            if (binX - ring >= 0 && binX - ring < index.binsX) considerBins(row + binX - ring, row + binX - ring);
+                            if (binX + ring >= 0 && binX + ring < index.binsX) considerBins(row + binX + ring, row + binX + ring);
+                        }
+                    }
+                }
+            }
+            else
+            {
+                for (auto enemyIt = enemyUnits.begin(); enemyIt != enemyUnits.end(); ++enemyIt)
+                {
+                    if (enemyIt->health < 1 || enemyIt->undetected || enemyIt == currentTarget) continue;
+                    if (enemyIt->flying)
+                    {
+                        if (fu.airDamage)
+                        {
+                            auto const d = distSquared<choke>(fu, *enemyIt);
+                            if (d < closestDistSquared && d >= fu.airMinRangeSquared)
+                            {
+                                closestDistSquared = d;
+                                closestEnemy = enemyIt;
+                            }
+                        }
+                    }
+                    else
+                    {
+                        if (fu.groundDamage)
+                        {
+                            auto const d = distSquared<choke>(fu, *enemyIt);
+                            if (d < closestDistSquared && d >= fu.groundMinRangeSquared)
+                            {
+                                closestDistSquared = d;
+                                closestEnemy = enemyIt;
+                            }
                         }
                     }
                 }
@@ -880,7 +1134,7 @@ namespace FAP
 
         for (auto it = friendlyUnits.begin(); it != friendlyUnits.end(); ++it)
         {
-            if (it->isOrganic && it->health < it->maxHealth && !it->didHealThisFrame)
+            if (it->isOrganic && !it->removed && it->health < it->maxHealth && !it->didHealThisFrame)
             {
                 auto const d = distSquared(fu, *it);
                 if (closestHealable == friendlyUnits.end() || d < closestDist)
@@ -918,6 +1172,8 @@ namespace FAP
 
         for (auto enemyIt = enemyUnits.begin(); enemyIt != enemyUnits.end(); ++enemyIt)
         {
+            if (enemyIt->removed) continue;
+
             if (enemyIt->flying)
             {
                 if (fu.airDamage)
@@ -1021,7 +1277,7 @@ namespace FAP
     template<bool tankSplash, bool choke>
     void FastAPproximation<UnitExtension>::isimulate()
     {
-        const auto simUnit = [this](auto &unit, auto &friendly, auto &enemy, std::vector<unsigned char> &collision)
+        const auto simUnit = [this](auto &unit, auto &friendly, auto &enemy, auto &enemyTargets, std::vector<unsigned char> &collision)
         {
             if (unit->health < 1)
             {
@@ -1033,12 +1289,13 @@ namespace FAP
                 auto const unitDied = suicideSim(*unit, friendly, enemy);
                 if (unitDied)
                 {
+                    // Leave a tombstone instead of erasing, so the rest of the vector isn't shifted for each death
                     auto temp = *unit;
-                    unit = friendly.erase(unit);
+                    unit->health = 0;
+                    unit->removed = true;
                     unitDeath(std::move(temp), friendly, enemy);
                 }
-                else
-                { ++unit; }
+                ++unit;
             }
             else
             {
@@ -1048,32 +1305,26 @@ namespace FAP
                 }
                 else
                 {
-                    unitsim<tankSplash, choke>(*unit, friendly, enemy, collision);
+                    unitsim<tankSplash, choke>(*unit, friendly, enemy, enemyTargets, collision);
                 }
                 ++unit;
             }
         };
 
+        player1Targets.binsValid = player2Targets.binsValid = false;
+
         for (auto fu = player1.begin(); fu != player1.end();)
         {
-            simUnit(fu, player1, player2, collisionPlayer1);
+            simUnit(fu, player1, player2, player2Targets, collisionPlayer1);
         }
 
         for (auto fu = player2.begin(); fu != player2.end();)
         {
-            simUnit(fu, player2, player1, collisionPlayer2);
+            simUnit(fu, player2, player1, player1Targets, collisionPlayer2);
         }
 
-        const auto updateUnit = [](auto &it, auto &friendly, auto &killed)
+        const auto updateUnit = [](auto &fu)
         {
-            auto &fu = *it;
-            if (fu.health < 1)
-            {
-                killed.push_back(fu);
-                it = friendly.erase(it);
-                return;
-            }
-
             if (fu.attackCooldownRemaining)
             {
                 --fu.attackCooldownRemaining;
@@ -1119,22 +1370,47 @@ namespace FAP
                     fu.health += 680;
                 }
             }
-
-            it++;
         };
 
+        // Dead units are compacted out in a single pass that keeps the order of the survivors
         auto updateUnits = [&](auto &friendly, auto &enemy)
         {
-            std::vector<FAPUnit<UnitExtension>> killed;
-            for (auto it = friendly.begin(); it != friendly.end();)
+            killed.clear();
+            auto out = friendly.begin();
+            for (auto it = friendly.begin(); it != friendly.end(); ++it)
             {
-                updateUnit(it, friendly, killed);
+                if (it->removed) continue;
+                if (it->health < 1)
+                {
+                    killed.push_back(std::move(*it));
+                    continue;
+                }
+
+                updateUnit(*it);
+                if (out != it) *out = std::move(*it);
+                ++out;
             }
-            for (auto &unit : killed)
+
+            if (out == friendly.end()) return;
+            friendly.erase(out, friendly.end());
+
+            if (!killed.empty())
             {
-                auto temp = unit;
-                unitDeath(std::move(temp), friendly, enemy);
+                killedIds.clear();
+                for (auto &unit : killed) killedIds.push_back(unit.id);
+                std::sort(killedIds.begin(), killedIds.end());
+                for (auto &unit : enemy)
+                {
+                    if (unit.target && std::binary_search(killedIds.begin(), killedIds.end(), unit.target)) unit.target = 0;
+                }
+
+                for (auto &unit : killed)
+                {
+                    bunkerDeath(std::move(unit), friendly);
+                }
             }
+
+            invalidateTargetIndexes();
         };
 
         updateUnits(player1, player2);
@@ -1151,6 +1427,14 @@ namespace FAP
         {
             if (enemy.target == fu.id) enemy.target = 0;
         }
+        bunkerDeath(std::move(fu), itsFriendlies);
+    }
+
+    template<typename UnitExtension>
+    void FastAPproximation<UnitExtension>::bunkerDeath(
+            FAPUnit<UnitExtension> &&fu,
+            std::vector<FAPUnit<UnitExtension>> &itsFriendlies)
+    {
         if (fu.unitType == BWAPI::UnitTypes::Terran_Bunker && fu.numAttackers)
         {
             fu.unitType = BWAPI::UnitTypes::Terran_Marine;
@@ -105,6 +105,8 @@ namespace FAP
 
         int id;
         int target = 0; // ID of current target
+
+        bool removed = false; // Died mid-frame and already handled, compacted out of the sim at the end of the frame
     };
 
     template<UnitValues values = UnitValues{}, typename UnitExtension = std::tuple<>>
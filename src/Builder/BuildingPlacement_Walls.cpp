@@ -36,6 +36,10 @@ namespace BuildingPlacement
         std::set<BWAPI::WalkPosition> neutralWalkTiles;
         std::set<BWAPI::TilePosition> mineralFieldTiles;
 
+        // Tiles valid for pathfinding through the wall, kept up-to-date as wall tiles are added and removed
+        TileBitset pathfindingTiles;
+        bool pathfindingTilesStale = true;
+
         // Struct used when generating and scoring all of the forge + gateway options
         struct ForgeGatewayWallOption
         {
@@ -97,6 +101,8 @@ namespace BuildingPlacement
                     reservedTiles.insert(BWAPI::TilePosition(x, y));
                 }
             }
+
+            pathfindingTilesStale = true;
         }
 
         bool walkableTile(BWAPI::TilePosition tile)
@@ -258,6 +264,11 @@ namespace BuildingPlacement
             });
         }
 
+        bool validPathfindingTile(BWAPI::TilePosition tile)
+        {
+            return walkableTile(tile) && !natural->mineralLineTiles.contains(tile);
+        }
+
         void addWallTiles(BWAPI::TilePosition tile, BWAPI::TilePosition size)
         {
             for (int x = tile.x; x < tile.x + size.x; x++)
@@ -265,6 +276,7 @@ namespace BuildingPlacement
                 for (int y = tile.y; y < tile.y + size.y; y++)
                 {
                     wallTiles.insert(BWAPI::TilePosition(x, y));
+                    if (!pathfindingTilesStale) pathfindingTiles.set(x, y, false);
                 }
             }
         }
@@ -276,13 +288,25 @@ namespace BuildingPlacement
                 for (int y = tile.y; y < tile.y + size.y; y++)
                 {
                     wallTiles.erase(BWAPI::TilePosition(x, y));
+                    if (!pathfindingTilesStale) pathfindingTiles.set(x, y, validPathfindingTile(BWAPI::TilePosition(x, y)));
                 }
             }
         }
 
-        bool validPathfindingTile(BWAPI::TilePosition tile)
+        void updatePathfindingTiles()
         {
-            return walkableTile(tile) && !natural->mineralLineTiles.contains(tile);
+            if (!pathfindingTilesStale) return;
+
+            pathfindingTiles = TileBitset(BWAPI::Broodwar->mapWidth(), BWAPI::Broodwar->mapHeight());
+            for (int y = 0; y < BWAPI::Broodwar->mapHeight(); y++)
+            {
+                for (int x = 0; x < BWAPI::Broodwar->mapWidth(); x++)
+                {
+                    pathfindingTiles.set(x, y, validPathfindingTile(BWAPI::TilePosition(x, y)));
+                }
+            }
+
+            pathfindingTilesStale = false;
         }
 
         size_t pathLength(BWAPI::TilePosition alternateStartTile = BWAPI::TilePositions::Invalid)
@@ -293,7 +317,8 @@ namespace BuildingPlacement
                 startTile = alternateStartTile;
             }
 
-            return PathFinding::Search(startTile, pathfindingEndTile, validPathfindingTile).size();
+            updatePathfindingTiles();
+            return PathFinding::Search(startTile, pathfindingEndTile, pathfindingTiles).size();
         }
 
         bool hasPathWithBuilding(BWAPI::TilePosition tile,
@@ -1773,6 +1798,7 @@ namespace BuildingPlacement
         ForgeGatewayWall createForgeGatewayWall(bool tight, int maxGapSize)
         {
             wallTiles.clear();
+            pathfindingTilesStale = true;
 
             // Initialize pathfinding
             size_t optimalPathLength = pathLength();
@@ -7,6 +7,8 @@
 #include "Base.h"
 #include "Map.h"
 #include "Units.h"
+#include "Timer.h"
+#include "General.h"
 
 #if INSTRUMENTATION_ENABLED
 #include <nlohmann/json.hpp>
@@ -36,6 +38,8 @@ namespace General
 
     void updateClusters()
     {
+        Timer::Zone zone("General::updateClusters");
+
         // Add completed and powered cannons to an appropriate squad
         // We currently only use cannons defensively, so we don't need to ever add them to attack squads
         for (auto &cannon : Units::allMineCompletedOfType(BWAPI::UnitTypes::Protoss_Photon_Cannon))
@@ -118,12 +122,21 @@ namespace General
 
         for (auto &squad : squads)
         {
+            Timer::Zone squadZone("General::updateSquadClusters");
             squad->updateClusters();
         }
     }
 
     void issueOrders()
     {
+        // Run the combat sims of all squads together, so they can be spread over the sim threads
+        std::vector<std::shared_ptr<CombatSim::Job>> simJobs;
+        for (auto &squad : squads)
+        {
+            squad->prepareCombatSims(simJobs);
+        }
+        CombatSim::run(simJobs);
+
         for (auto &squad : squads)
         {
             squad->execute();
@@ -36,4 +36,16 @@ namespace CombatSim
 
     // Used from tests for sim evaluation
     void setMaxIterations(int iterations);
+
+    // Sets how many frames sim results are reused for, 0 to disable the cache
+    void setCacheFrames(int frames);
+
+    // Used from tests to check whether a prepared sim took its result from the cache
+    bool isCached(const Job &job);
+
+    // Writes the hit rate of the sim result cache to CherryVis
+    void writeInstrumentation();
+
+    // Runs prepared sims that haven't been run yet, spread over the sim threads, returning when all have finished
+    void run(const std::vector<std::shared_ptr<Job>> &jobs);
 }
@@ -1,5 +1,6 @@
 #include "Squad.h"
 #include "Players.h"
+#include "Timer.h"
 
 #include <iomanip>
 
@@ -138,6 +139,25 @@ void Squad::removeUnit(const MyUnit &unit)
     }
 }
 
+void Squad::updateClusterPositions()
+{
+    Timer::Zone zone("Squad::updateClusterPositions");
+
+    for (auto clusterIt = clusters.begin(); clusterIt != clusters.end();)
+    {
+        (*clusterIt)->updatePositions(targetPosition);
+
+        if ((*clusterIt)->units.empty())
+        {
+            clusterIt = clusters.erase(clusterIt);
+        }
+        else
+        {
+            clusterIt++;
+        }
+    }
+}
+
 void Squad::updateClusters()
 {
     // If we have no target position, skip this
@@ -174,19 +194,7 @@ void Squad::updateClusters()
     }
 
     // Update the clusters: remove dead units, recompute position data
-    for (auto clusterIt = clusters.begin(); clusterIt != clusters.end();)
-    {
-        (*clusterIt)->updatePositions(targetPosition);
-
-        if ((*clusterIt)->units.empty())
-        {
-            clusterIt = clusters.erase(clusterIt);
-        }
-        else
-        {
-            clusterIt++;
-        }
-    }
+    updateClusterPositions();
 
     // Find clusters that should be combined
     for (auto firstIt = clusters.begin(); firstIt != clusters.end();)
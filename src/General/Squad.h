@@ -17,6 +17,9 @@ public:
 
     void updateClusters();
 
+    // Prepares the combat sims the squad needs this frame, so the sims of all squads can be run together before they execute
+    virtual void prepareCombatSims(std::vector<std::shared_ptr<CombatSim::Job>> &jobs) {}
+
     virtual void execute();
 
     virtual void disband() {}
@@ -80,6 +83,8 @@ protected:
     void updateDetectionNeeds(std::set<Unit> &enemyUnits);
 
 private:
+    void updateClusterPositions();
+
     void executeDetectors();
     void executeArbiters();
 };
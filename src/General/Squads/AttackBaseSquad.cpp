@@ -336,13 +336,48 @@ namespace
     }
 }
 
-void AttackBaseSquad::execute(UnitCluster &cluster)
+void AttackBaseSquad::prepareCombatSims(std::vector<std::shared_ptr<CombatSim::Job>> &jobs)
+{
+    clusterSims.clear();
+
+    std::vector<UnitCluster *> clustersInContact;
+    for (const auto &cluster : clusters)
+    {
+        auto &clusterSim = clusterSims[cluster.get()];
+        clusterSim.frame = currentFrame;
+        enemyUnitsNear(*cluster, clusterSim.enemyUnits);
+        if (!clusterSim.enemyUnits.empty()) clustersInContact.push_back(cluster.get());
+    }
+
+    // A single sim gains nothing from being batched, so it is left to execute
+    if (clustersInContact.size() < 2) return;
+
+    for (auto cluster : clustersInContact)
+    {
+        auto &clusterSim = clusterSims[cluster];
+        clusterSim.unitsAndTargets = cluster->selectTargets(clusterSim.enemyUnits, targetPosition);
+        clusterSim.job = cluster->prepareCombatSim(targetPosition, clusterSim.unitsAndTargets, clusterSim.enemyUnits, detectors);
+        jobs.push_back(clusterSim.job);
+    }
+}
+
+void AttackBaseSquad::enemyUnitsNear(UnitCluster &cluster, std::set<Unit> &enemyUnits)
 {
-    // Look for enemies near this cluster
-    std::set<Unit> enemyUnits;
     int radius = 640;
     if (cluster.vanguard) radius += cluster.vanguard->getDistance(cluster.center);
     Units::enemyInRadius(enemyUnits, cluster.center, radius);
+}
+
+void AttackBaseSquad::execute(UnitCluster &cluster)
+{
+    // Look for enemies near this cluster, unless this was done before the squads executed
+    auto &clusterSim = clusterSims[&cluster];
+    if (clusterSim.frame != currentFrame)
+    {
+        clusterSim = ClusterSim{currentFrame};
+        enemyUnitsNear(cluster, clusterSim.enemyUnits);
+    }
+    auto &enemyUnits = clusterSim.enemyUnits;
 
     // If there are no enemies near the cluster, just move towards the target
     if (enemyUnits.empty())
@@ -354,8 +389,9 @@ void AttackBaseSquad::execute(UnitCluster &cluster)
 
     updateDetectionNeeds(enemyUnits);
 
-    // Select targets
-    auto unitsAndTargets = cluster.selectTargets(enemyUnits, targetPosition);
+    // Select targets, unless they were selected when the sim was batched
+    if (!clusterSim.job) clusterSim.unitsAndTargets = cluster.selectTargets(enemyUnits, targetPosition);
+    auto &unitsAndTargets = clusterSim.unitsAndTargets;
 
     // Scan the targets to see if any of our units have a valid target that has been seen recently
     bool hasValidTarget = false;
@@ -379,8 +415,10 @@ void AttackBaseSquad::execute(UnitCluster &cluster)
         }
     }
 
-    // Run combat sim
-    auto simResult = cluster.runCombatSim(targetPosition, unitsAndTargets, enemyUnits, detectors);
+    // Run combat sim, unless it was batched
+    auto simResult = clusterSim.job
+                     ? cluster.combatSimResult(*clusterSim.job)
+                     : cluster.runCombatSim(targetPosition, unitsAndTargets, enemyUnits, detectors);
 
     // TODO: If our units can't do any damage (e.g. ground-only vs. air, melee vs. kiting ranged units), do something else
 
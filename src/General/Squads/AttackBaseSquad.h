@@ -33,6 +33,22 @@ public:
     Base *base;
     bool ignoreCombatSim;
 
+    void prepareCombatSims(std::vector<std::shared_ptr<CombatSim::Job>> &jobs) override;
+
 private:
+    // The enemy units near a cluster, gathered before the squads execute
+    // When several clusters are in contact, their targets are also selected then and their sims batched
+    struct ClusterSim
+    {
+        int frame = -1;
+        std::set<Unit> enemyUnits;
+        std::vector<std::pair<MyUnit, Unit>> unitsAndTargets;
+        std::shared_ptr<CombatSim::Job> job;
+    };
+
+    std::map<UnitCluster *, ClusterSim> clusterSims;
+
+    void enemyUnitsNear(UnitCluster &cluster, std::set<Unit> &enemyUnits);
+
     void execute(UnitCluster &cluster) override;
 };
@@ -249,11 +249,11 @@ void EarlyGameDefendMainBaseSquad::initializeChoke()
         if (choke->isNarrowChoke)
         {
             auto grid = PathFinding::getNavigationGrid(base->getPosition());
-            auto end1Node = grid ? &(*grid)[choke->end1Center] : nullptr;
-            auto end2Node = grid ? &(*grid)[choke->end2Center] : nullptr;
-            if (end1Node && end1Node->nextNode && end2Node && end2Node->nextNode)
+            auto end1Node = grid ? (*grid)[choke->end1Center] : NavigationGrid::GridNode();
+            auto end2Node = grid ? (*grid)[choke->end2Center] : NavigationGrid::GridNode();
+            if (end1Node && end1Node.nextNode() && end2Node && end2Node.nextNode())
             {
-                chokeDefendEnd = end1Node->cost < end2Node->cost ? choke->end1Center : choke->end2Center;
+                chokeDefendEnd = end1Node.cost() < end2Node.cost() ? choke->end1Center : choke->end2Center;
             }
             else
             {
@@ -156,7 +156,7 @@ void MopUpSquad::execute(UnitCluster &cluster)
 
                 BWAPI::TilePosition tile(x, y);
 
-                if ((*grid)[tile].cost == USHRT_MAX) continue;
+                if ((*grid)[tile].cost() == USHRT_MAX) continue;
 
                 int dist = PathFinding::GetGroundDistance(cluster.center, BWAPI::Position(tile));
                 if (frame < bestFrame || dist < bestDist)
@@ -4,6 +4,11 @@
 #include "MyUnit.h"
 #include "CombatSimResult.h"
 
+namespace CombatSim
+{
+    struct Job;
+}
+
 class UnitCluster
 {
 public:
@@ -96,6 +101,17 @@ public:
                                  bool attacking = true,
                                  Choke *choke = nullptr);
 
+    // Gathers the units for a combat sim without running it, so it can be run alongside other sims with CombatSim::run
+    std::shared_ptr<CombatSim::Job> prepareCombatSim(BWAPI::Position targetPosition,
+                                                     std::vector<std::pair<MyUnit, Unit>> &unitsAndTargets,
+                                                     std::set<Unit> &targets,
+                                                     std::set<MyUnit> &detectors,
+                                                     bool attacking = true,
+                                                     Choke *choke = nullptr);
+
+    // Gets the result of a prepared combat sim, running it on the frame thread if it hasn't been run yet
+    CombatSimResult combatSimResult(CombatSim::Job &job);
+
     void addSimResult(CombatSimResult &simResult, bool attack);
 
     void addRegroupSimResult(CombatSimResult &simResult, bool contain);
@@ -7,11 +7,23 @@
 #include "General.h"
 
 #include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <utility>
 
 #include "DebugFlag_CombatSim.h"
 
 #define LIMIT_MICROSECONDS 5000
 
+// Sim results are reused for this many frames when the units going into a sim are the same at the resolution below
+// Set to 0 to always run the sims
+#define CACHE_FRAMES 6
+#define CACHE_POSITION_SHIFT 3  // 8 pixels
+#define CACHE_HEALTH_SHIFT 2    // 4 hit points or shields
+#define CACHE_COOLDOWN_SHIFT 2  // 4 frames
+
 #if INSTRUMENTATION_ENABLED_VERBOSE
 #define DEBUG_COMBATSIM_CSV false          // Writes a CSV file for each cluster with detailed sim information
 #define DEBUG_COMBATSIM_CSV_FREQUENCY 1  // Frequency at which to write CSV output
@@ -24,12 +36,25 @@
 #define DEBUG_COMBATSIM_DRAW_ATTACKER false  // Whether to draw attacker or defender
 #endif
 
+// Set to false to run all sims on the frame thread
+// Drawing and CSV output are not thread-safe, so sims that produce them always run on the frame thread
+#if DEBUG_COMBATSIM_DRAW || DEBUG_COMBATSIM_CSV
+#define COMBATSIM_THREADS false
+#else
+#define COMBATSIM_THREADS true
+#endif
+
 namespace
 {
-    // FAP collision vectors
-    // Allocated here at initialization to avoid re-allocations
-    std::vector<unsigned char> collisionPlayer1;
-    std::vector<unsigned char> collisionPlayer2;
+    // FAP collision vectors, one pair for each thread that runs sims
+    // Kept between sims to avoid re-allocations
+    struct CollisionBuffers
+    {
+        std::vector<unsigned char> player1;
+        std::vector<unsigned char> player2;
+    };
+    CollisionBuffers frameThreadCollision;
+    size_t collisionSize;
 
     // Cache of unit scores
     int baseScore[BWAPI::UnitTypes::Enum::MAX];
@@ -37,6 +62,18 @@ namespace
 
     // Parameters
     int maxIterations;
+    int cacheFrames;
+
+    // Cache of recent sim results, keyed by a hash of the quantized sim inputs
+    struct CachedResult
+    {
+        int frame;
+        CombatSimResult result;
+    };
+    std::unordered_map<unsigned long long, CachedResult> resultCache;
+    int lastCachePruneFrame;
+    int cacheHits;
+    int cacheMisses;
 
     // Whether a unit goes into the sim
     bool isSimUnit(const Unit &unit)
@@ -52,8 +89,7 @@ namespace
     }
 
     auto inline makeUnit(const Unit &unit,
-                         const Unit &vanguard,
-                         bool mobileDetection,
+                         bool undetected,
                          BWAPI::Position targetPosition = BWAPI::Positions::Invalid,
                          int target = 0)
     {
@@ -123,7 +159,7 @@ namespace
                 .setShieldUpgrades(0)
 
                 .setStimmed(unit->stimmedUntil > currentFrame)
-                .setUndetected(unit->isCliffedTank(vanguard) || (unit->undetected && !mobileDetection))
+                .setUndetected(undetected)
 
                 .setID(unit->id)
                 .setTarget(target)
@@ -133,6 +169,42 @@ namespace
                 .setData({});
     }
 
+    // FNV-1a over the quantized inputs of a sim, used as the result cache key
+    // Everything that can change the result has to be included
+    struct CacheKey
+    {
+        unsigned long long hash = 14695981039346656037ULL;
+
+        void add(long long value)
+        {
+            hash ^= (unsigned long long)value;
+            hash *= 1099511628211ULL;
+        }
+
+        void addUnit(const Unit &unit, int target, bool undetected)
+        {
+            add(unit->id);
+            add(unit->type);
+            add(target);
+            add(unit->simPosition.x >> CACHE_POSITION_SHIFT);
+            add(unit->simPosition.y >> CACHE_POSITION_SHIFT);
+            add(unit->lastHealth >> CACHE_HEALTH_SHIFT);
+            add(unit->lastShields >> CACHE_HEALTH_SHIFT);
+            add(std::max(0, unit->cooldownUntil - currentFrame) >> CACHE_COOLDOWN_SHIFT);
+            add(unit->isFlying);
+            add(unit->stimmedUntil > currentFrame);
+            add((long long)(Players::unitTopSpeed(unit->player, unit->type) * 256.0));
+            add(Players::unitGroundCooldown(unit->player, unit->type));
+            add(Players::unitAirCooldown(unit->player, unit->type));
+            add(unit->groundDamage());
+            add(unit->airDamage());
+            add(unit->groundRange());
+            add(unit->airRange());
+            add(Players::unitArmor(unit->player, unit->type));
+            add(undetected);
+        }
+    };
+
     int score(std::vector<FAP::FAPUnit<>> *units)
     {
         int result = 0;
@@ -143,105 +215,106 @@ namespace
 
         return result;
     }
+}
 
-    template<bool choke>
-    CombatSimResult execute(
-            BWAPI::Position targetPosition,
-            UnitCluster *cluster,
-            std::vector<std::pair<MyUnit, Unit>> &unitsAndTargets,
-            std::set<Unit> &targets,
-            std::set<MyUnit> &detectors,
-            bool attacking,
-            Choke *narrowChoke = nullptr)
+namespace CombatSim
+{
+    // A combat sim with its units already built on the frame thread, so it can be run on any thread
+    struct Job
     {
-#if DEBUG_COMBATSIM_CSV
-        int minUnitId = INT_MAX;
-#endif
+        using SimUnit = decltype(makeUnit(std::declval<const Unit &>(), false));
 
-        std::fill(collisionPlayer1.begin(), collisionPlayer1.end(), 0);
-        std::fill(collisionPlayer2.begin(), collisionPlayer2.end(), 0);
-        FAP::FastAPproximation sim(collisionPlayer1, collisionPlayer2);
-        if (narrowChoke)
-        {
-            sim.setChokeGeometry(narrowChoke->tileSide,
-                                 narrowChoke->end1Center,
-                                 narrowChoke->end2Center,
-                                 narrowChoke->end1Exit,
-                                 narrowChoke->end2Exit);
-        }
+        bool attacking = true;
+        Choke *narrowChoke = nullptr;
+        int iterations = 0;
 
-        bool allTierOne = true;
+        std::vector<SimUnit> player1;
+        std::vector<SimUnit> player2;
 
-        // Add our units with initial target
         int myCount = 0;
-        for (auto &unitAndTarget : unitsAndTargets)
-        {
-            if (!isSimUnit(unitAndTarget.first)) continue;
-
-            auto target = unitAndTarget.second ? unitAndTarget.second->id : 0;
-            if (attacking)
-            {
-                sim.addPlayer1<choke>(makeUnit(unitAndTarget.first, cluster->vanguard, false, targetPosition, target));
-            }
-            else
-            {
-                sim.addPlayer2<choke>(makeUnit(unitAndTarget.first, cluster->vanguard, false, targetPosition, target));
-            }
-
-            myCount++;
-            if (unitAndTarget.first->type != BWAPI::UnitTypes::Protoss_Zealot) allTierOne = false;
+        int enemyCount = 0;
+        bool enemyHasUndetectedUnits = false;
 
 #if DEBUG_COMBATSIM_CSV
-            if (unitAndTarget.first->id < minUnitId) minUnitId = unitAndTarget.first->id;
+        int minUnitId = INT_MAX;
+#endif
+#if DEBUG_COMBATSIM_DRAW
+        bool draw = false;
 #endif
-        }
 
-        // Determine if we have mobile detection with this cluster
-        bool haveMobileDetection = false;
-        for (const auto &detector : detectors)
-        {
-            if (cluster->vanguard && cluster->vanguard->getDistance(detector) < 480)
-            {
-                haveMobileDetection = true;
-                break;
-            }
-        }
+        unsigned long long cacheKey = 0;
 
-        // Add enemy units
-        int enemyCount = 0;
-        bool enemyHasUndetectedUnits = false;
-        for (auto &unit : targets)
-        {
-            if (!isSimUnit(unit)) continue;
-            if (unit->undetected && !haveMobileDetection) enemyHasUndetectedUnits = true;
+        bool empty = false;   // Nothing to simulate, so the result is the default
+        bool cached = false;  // The result was taken from the result cache
+        bool done = false;
+        int abortedAfter = 0; // Iterations run before the time limit cut the sim short, if it did
+        CombatSimResult result;
+    };
+}
 
-            // Only include workers if they have been seen attacking recently
-            // TODO: Handle worker rushes
-            if (!unit->type.isWorker() || (currentFrame - unit->lastSeenAttacking) < 120)
+namespace
+{
+    // Takes the result of an equivalent sim run in the last few frames, if there is one
+    bool useCachedResult(CombatSim::Job &job)
+    {
+        if (lastCachePruneFrame != currentFrame)
+        {
+            for (auto it = resultCache.begin(); it != resultCache.end();)
             {
-                if (attacking)
+                if (currentFrame - it->second.frame > cacheFrames)
                 {
-                    sim.addPlayer2<choke>(makeUnit(unit, cluster->vanguard, haveMobileDetection));
+                    it = resultCache.erase(it);
                 }
                 else
                 {
-                    sim.addPlayer1<choke>(makeUnit(unit, cluster->vanguard, haveMobileDetection));
+                    it++;
                 }
+            }
+            lastCachePruneFrame = currentFrame;
+        }
 
-                enemyCount++;
+        auto it = resultCache.find(job.cacheKey);
+        if (it == resultCache.end()) return false;
 
-                if (unit->type != BWAPI::UnitTypes::Protoss_Zealot &&
-                    unit->type != BWAPI::UnitTypes::Zerg_Zergling &&
-                    unit->type != BWAPI::UnitTypes::Terran_Marine)
-                {
-                    allTierOne = false;
-                }
-            }
+        job.result = it->second.result;
+        job.result.frame = currentFrame;
+        job.player1.clear();
+        job.player2.clear();
+        job.cached = true;
+        job.done = true;
+        return true;
+    }
+
+    template<bool choke>
+    void simulate(CombatSim::Job &job, CollisionBuffers &collision)
+    {
+        collision.player1.assign(collisionSize, 0);
+        collision.player2.assign(collisionSize, 0);
+        FAP::FastAPproximation sim(collision.player1, collision.player2);
+        if (job.narrowChoke)
+        {
+            sim.setChokeGeometry(job.narrowChoke->tileSide,
+                                 job.narrowChoke->end1Center,
+                                 job.narrowChoke->end2Center,
+                                 job.narrowChoke->end1Exit,
+                                 job.narrowChoke->end2Exit);
+        }
+
+        for (auto &unit : job.player1)
+        {
+            sim.template addPlayer1<choke>(std::move(unit));
+        }
+        for (auto &unit : job.player2)
+        {
+            sim.template addPlayer2<choke>(std::move(unit));
         }
+        job.player1.clear();
+        job.player2.clear();
+
+        bool attacking = job.attacking;
 
 #if DEBUG_COMBATSIM_CSV
-        std::string simCsvLabel = (std::ostringstream() << "clustersim-" << minUnitId).str();
-        std::string actualCsvLabel = (std::ostringstream() << "clustersimactuals-" << minUnitId).str();
+        std::string simCsvLabel = (std::ostringstream() << "clustersim-" << job.minUnitId).str();
         auto writeSimCsvLine = [&simCsvLabel](const auto &unit, int simFrame)
         {
             auto csv = Log::Csv(simCsvLabel);
@@ -256,33 +329,6 @@ namespace
             csv << unit.shields;
             csv << unit.attackCooldownRemaining;
         };
-
-        auto writeActualCsvLine = [&actualCsvLabel](const Unit &unit)
-        {
-            auto csv = Log::Csv(actualCsvLabel);
-            csv << currentFrame;
-            csv << "-";
-            csv << currentFrame;
-            csv << unit->type;
-            csv << unit->id;
-            csv << unit->lastPosition.x;
-            csv << unit->lastPosition.y;
-            csv << unit->lastHealth;
-            csv << unit->lastShields;
-            csv << std::max(0, unit->cooldownUntil - currentFrame);
-        };
-
-        if (attacking == DEBUG_COMBATSIM_CSV_ATTACKER && currentFrame % DEBUG_COMBATSIM_CSV_FREQUENCY == 0)
-        {
-            for (auto &unitAndTarget : unitsAndTargets)
-            {
-                writeActualCsvLine(unitAndTarget.first);
-            }
-            for (auto &target : targets)
-            {
-                writeActualCsvLine(target);
-            }
-        }
 #endif
 #if DEBUG_COMBATSIM_CVIS
         // Unit ID to: x, y, target, cooldown
@@ -305,8 +351,7 @@ namespace
         int initialMine = score(attacking ? sim.getState().first : sim.getState().second);
         int initialEnemy = score(attacking ? sim.getState().second : sim.getState().first);
 
-        int iterations = maxIterations;
-        if (allTierOne && !attacking) iterations /= 4;
+        int iterations = job.iterations;
 
 #if DEBUG_COMBATSIM_EACHFRAME
         std::vector<int> eachFrameMine;
@@ -326,8 +371,7 @@ namespace
             std::map<int, std::tuple<int, int, int>> player1DrawData;
             std::map<int, std::tuple<int, int, int>> player2DrawData;
 
-            if (attacking == DEBUG_COMBATSIM_DRAW_ATTACKER
-                && ((unitsAndTargets.size() + targets.size()) < 10 || currentFrame % DEBUG_COMBATSIM_DRAW_FREQUENCY == 0))
+            if (job.draw)
             {
                 auto setDrawData = [](auto &simData, auto &localData)
                 {
@@ -341,11 +385,10 @@ namespace
             }
 #endif
 
-            sim.simulate<true, choke>(1);
+            sim.template simulate<true, choke>(1);
 
 #if DEBUG_COMBATSIM_DRAW
-            if (attacking == DEBUG_COMBATSIM_DRAW_ATTACKER
-                && ((unitsAndTargets.size() + targets.size()) < 10 || currentFrame % DEBUG_COMBATSIM_DRAW_FREQUENCY == 0))
+            if (job.draw)
             {
                 auto draw = [](auto &simData, auto &localData, auto color)
                 {
@@ -407,7 +450,7 @@ namespace
             auto duration = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() - startTime).count();
             if (duration > LIMIT_MICROSECONDS)
             {
-                if (iterations < maxIterations) CherryVis::log() << "Sim aborted after " << i << "iterations";
+                job.abortedAfter = i;
                 break;
             }
         }
@@ -415,48 +458,131 @@ namespace
         int finalMine = score(attacking ? sim.getState().first : sim.getState().second);
         int finalEnemy = score(attacking ? sim.getState().second : sim.getState().first);
 
-#if DEBUG_COMBATSIM_LOG
-        std::ostringstream debug;
-        debug << BWAPI::WalkPosition(cluster->center);
-        if (!attacking && narrowChoke)
+        job.result = CombatSimResult(
+                job.myCount,
+                job.enemyCount,
+                initialMine,
+                initialEnemy,
+                finalMine,
+                finalEnemy,
+#if DEBUG_COMBATSIM_EACHFRAME
+                std::move(eachFrameMine),
+                std::move(eachFrameEnemy),
+#endif
+                job.enemyHasUndetectedUnits,
+                job.narrowChoke
+#if DEBUG_COMBATSIM_CVIS
+                , std::move(unitLog)
+#endif
+        );
+        job.done = true;
+    }
+
+    void simulate(CombatSim::Job &job, CollisionBuffers &collision)
+    {
+        if (job.narrowChoke)
         {
-            debug << " (defend " << BWAPI::WalkPosition(narrowChoke->center) << ")";
+            simulate<true>(job, collision);
         }
-        else if (narrowChoke)
+        else
         {
-            debug << " (through " << BWAPI::WalkPosition(narrowChoke->center) << ")";
+            simulate<false>(job, collision);
         }
-        debug << ": " << initialMine << "," << initialEnemy
-              << "-" << finalMine << "," << finalEnemy;
-        CherryVis::log() << debug.str();
-#endif
+    }
 
-        return {
-            myCount,
-            enemyCount,
-            initialMine,
-            initialEnemy,
-            finalMine,
-            finalEnemy,
-#if DEBUG_COMBATSIM_EACHFRAME
-            std::move(eachFrameMine),
-            std::move(eachFrameEnemy),
-#endif
-            enemyHasUndetectedUnits,
-            narrowChoke,
-#if DEBUG_COMBATSIM_CVIS
-            std::move(unitLog),
+#if COMBATSIM_THREADS
+    // Runs batches of sims on a pool of threads, with the frame thread working on the batch as well
+    // Each thread has its own collision vectors, as the sims are otherwise independent
+    // Allocated once and never destroyed, so the threads can never outlive what they wait on at process exit
+    struct SimThreads
+    {
+        std::mutex mutex;
+        std::condition_variable jobAvailable;
+        std::condition_variable jobFinished;
+        std::deque<CombatSim::Job *> jobs;
+        int unfinished = 0;
+
+        explicit SimThreads(unsigned int count)
+        {
+            for (unsigned int i = 0; i < count; i++)
+            {
+                std::thread([this]()
+                            {
+                                CollisionBuffers collision;
+                                while (true)
+                                {
+                                    CombatSim::Job *job;
+                                    {
+                                        std::unique_lock<std::mutex> lock(mutex);
+                                        jobAvailable.wait(lock, [this]() { return !jobs.empty(); });
+                                        job = jobs.front();
+                                        jobs.pop_front();
+                                    }
+
+                                    simulate(*job, collision);
+                                    finished();
+                                }
+                            }).detach();
+            }
+        }
+
+        void finished()
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                unfinished--;
+            }
+            jobFinished.notify_all();
+        }
+
+        void run(std::vector<CombatSim::Job *> &batch)
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                jobs.insert(jobs.end(), batch.begin(), batch.end());
+                unfinished += (int)batch.size();
+            }
+            jobAvailable.notify_all();
+
+            while (true)
+            {
+                CombatSim::Job *job;
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    if (jobs.empty()) break;
+                    job = jobs.front();
+                    jobs.pop_front();
+                }
+
+                simulate(*job, frameThreadCollision);
+                finished();
+            }
+
+            std::unique_lock<std::mutex> lock(mutex);
+            jobFinished.wait(lock, [this]() { return unfinished == 0; });
+        }
+    };
+
+    SimThreads *simThreads = nullptr;
 #endif
-        };
-    }
 }
 
 namespace CombatSim
 {
     void initialize()
     {
-        collisionPlayer1.resize(BWAPI::Broodwar->mapWidth() * BWAPI::Broodwar->mapHeight() * 4, 0);
-        collisionPlayer2.resize(BWAPI::Broodwar->mapWidth() * BWAPI::Broodwar->mapHeight() * 4, 0);
+        collisionSize = BWAPI::Broodwar->mapWidth() * BWAPI::Broodwar->mapHeight() * 4;
+        frameThreadCollision.player1.assign(collisionSize, 0);
+        frameThreadCollision.player2.assign(collisionSize, 0);
+
+#if COMBATSIM_THREADS
+        // Leave a core for the frame thread, which also runs sims
+        if (!simThreads)
+        {
+            auto cores = std::thread::hardware_concurrency();
+            if (cores > 1) simThreads = new SimThreads(std::min(cores - 1, 7U));
+        }
+#endif
 
         for (auto type : BWAPI::UnitTypes::allUnitTypes())
         {
@@ -524,6 +650,12 @@ namespace CombatSim
         }
 
         maxIterations = 288;
+        cacheFrames = CACHE_FRAMES;
+
+        resultCache.clear();
+        lastCachePruneFrame = -1;
+        cacheHits = 0;
+        cacheMisses = 0;
     }
 
     int unitValue(const FAP::FAPUnit<> &unit)
@@ -546,18 +678,69 @@ namespace CombatSim
     {
         maxIterations = iterations;
     }
+
+    void setCacheFrames(int frames)
+    {
+        cacheFrames = frames;
+        resultCache.clear();
+    }
+
+    bool isCached(const Job &job)
+    {
+        return job.cached;
+    }
+
+    void writeInstrumentation()
+    {
+#if INSTRUMENTATION_ENABLED
+        int lookups = cacheHits + cacheMisses;
+        if (lookups == 0) return;
+
+        std::ostringstream hitRate;
+        hitRate << cacheHits << "/" << lookups << " (" << (cacheHits * 100 / lookups) << "%)";
+        CherryVis::setBoardValue("combatsim-cache-hits", hitRate.str());
+#endif
+    }
+
+    void run(const std::vector<std::shared_ptr<Job>> &jobs)
+    {
+        std::vector<Job *> batch;
+        for (auto &job : jobs)
+        {
+            if (!job->done) batch.push_back(job.get());
+        }
+        if (batch.empty()) return;
+
+#if COMBATSIM_THREADS
+        if (simThreads && batch.size() > 1)
+        {
+            simThreads->run(batch);
+            return;
+        }
+#endif
+
+        for (auto job : batch)
+        {
+            simulate(*job, frameThreadCollision);
+        }
+    }
 }
 
-CombatSimResult UnitCluster::runCombatSim(BWAPI::Position targetPosition,
-                                          std::vector<std::pair<MyUnit, Unit>> &unitsAndTargets,
-                                          std::set<Unit> &targets,
-                                          std::set<MyUnit> &detectors,
-                                          bool attacking,
-                                          Choke *choke)
+std::shared_ptr<CombatSim::Job> UnitCluster::prepareCombatSim(BWAPI::Position targetPosition,
+                                                               std::vector<std::pair<MyUnit, Unit>> &unitsAndTargets,
+                                                               std::set<Unit> &targets,
+                                                               std::set<MyUnit> &detectors,
+                                                               bool attacking,
+                                                               Choke *choke)
 {
+    auto job = std::make_shared<CombatSim::Job>();
+    job->attacking = attacking;
+
     if (unitsAndTargets.empty() || targets.empty())
     {
-        return CombatSimResult{};
+        job->empty = true;
+        job->done = true;
+        return job;
     }
 
     // Check if the armies are separated by a narrow choke
@@ -596,12 +779,169 @@ CombatSimResult UnitCluster::runCombatSim(BWAPI::Position targetPosition,
         }
     }
 
-    if (narrowChoke)
+    job->narrowChoke = narrowChoke;
+
+    bool allTierOne = true;
+    CacheKey key;
+
+    // Add our units with initial target
+    for (auto &unitAndTarget : unitsAndTargets)
+    {
+        if (!isSimUnit(unitAndTarget.first)) continue;
+
+        auto target = unitAndTarget.second ? unitAndTarget.second->id : 0;
+        bool undetected = unitAndTarget.first->isCliffedTank(vanguard) || unitAndTarget.first->undetected;
+        (attacking ? job->player1 : job->player2).push_back(makeUnit(unitAndTarget.first, undetected, targetPosition, target));
+        key.addUnit(unitAndTarget.first, target, undetected);
+
+        job->myCount++;
+        if (unitAndTarget.first->type != BWAPI::UnitTypes::Protoss_Zealot) allTierOne = false;
+
+#if DEBUG_COMBATSIM_CSV
+        if (unitAndTarget.first->id < job->minUnitId) job->minUnitId = unitAndTarget.first->id;
+#endif
+    }
+
+    // Determine if we have mobile detection with this cluster
+    bool haveMobileDetection = false;
+    for (const auto &detector : detectors)
+    {
+        if (vanguard && vanguard->getDistance(detector) < 480)
+        {
+            haveMobileDetection = true;
+            break;
+        }
+    }
+
+    // Add enemy units
+    for (auto &unit : targets)
+    {
+        if (!isSimUnit(unit)) continue;
+        if (unit->undetected && !haveMobileDetection) job->enemyHasUndetectedUnits = true;
+
+        // Only include workers if they have been seen attacking recently
+        // TODO: Handle worker rushes
+        if (!unit->type.isWorker() || (currentFrame - unit->lastSeenAttacking) < 120)
+        {
+            bool undetected = unit->isCliffedTank(vanguard) || (unit->undetected && !haveMobileDetection);
+            (attacking ? job->player2 : job->player1).push_back(makeUnit(unit, undetected));
+            key.addUnit(unit, 0, undetected);
+
+            job->enemyCount++;
+
+            if (unit->type != BWAPI::UnitTypes::Protoss_Zealot &&
+                unit->type != BWAPI::UnitTypes::Zerg_Zergling &&
+                unit->type != BWAPI::UnitTypes::Terran_Marine)
+            {
+                allTierOne = false;
+            }
+        }
+    }
+
+    job->iterations = maxIterations;
+    if (allTierOne && !attacking) job->iterations /= 4;
+
+#if DEBUG_COMBATSIM_CSV
+    std::string actualCsvLabel = (std::ostringstream() << "clustersimactuals-" << job->minUnitId).str();
+    auto writeActualCsvLine = [&actualCsvLabel](const Unit &unit)
+    {
+        auto csv = Log::Csv(actualCsvLabel);
+        csv << currentFrame;
+        csv << "-";
+        csv << currentFrame;
+        csv << unit->type;
+        csv << unit->id;
+        csv << unit->lastPosition.x;
+        csv << unit->lastPosition.y;
+        csv << unit->lastHealth;
+        csv << unit->lastShields;
+        csv << std::max(0, unit->cooldownUntil - currentFrame);
+    };
+
+    if (attacking == DEBUG_COMBATSIM_CSV_ATTACKER && currentFrame % DEBUG_COMBATSIM_CSV_FREQUENCY == 0)
+    {
+        for (auto &unitAndTarget : unitsAndTargets)
+        {
+            writeActualCsvLine(unitAndTarget.first);
+        }
+        for (auto &target : targets)
+        {
+            writeActualCsvLine(target);
+        }
+    }
+#endif
+#if DEBUG_COMBATSIM_DRAW
+    job->draw = attacking == DEBUG_COMBATSIM_DRAW_ATTACKER
+                && ((unitsAndTargets.size() + targets.size()) < 10 || currentFrame % DEBUG_COMBATSIM_DRAW_FREQUENCY == 0);
+#endif
+
+    if (cacheFrames > 0)
+    {
+        key.add(attacking);
+        key.add((long long)(intptr_t)narrowChoke);
+        key.add(job->iterations);
+        key.add(job->enemyHasUndetectedUnits);
+        key.add(targetPosition.x >> CACHE_POSITION_SHIFT);
+        key.add(targetPosition.y >> CACHE_POSITION_SHIFT);
+        job->cacheKey = key.hash;
+        useCachedResult(*job);
+    }
+
+    return job;
+}
+
+CombatSimResult UnitCluster::combatSimResult(CombatSim::Job &job)
+{
+    if (job.empty) return job.result;
+
+    if (!job.done)
+    {
+        simulate(job, frameThreadCollision);
+    }
+
+    // Hits and misses are counted here rather than at lookup, so sims that are prepared but not used don't count
+    if (cacheFrames > 0 && job.cached)
+    {
+        cacheHits++;
+    }
+    else if (cacheFrames > 0)
+    {
+        cacheMisses++;
+        resultCache[job.cacheKey] = CachedResult{currentFrame, job.result};
+    }
+
+    if (job.abortedAfter && job.iterations < maxIterations)
+    {
+        CherryVis::log() << "Sim aborted after " << job.abortedAfter << "iterations";
+    }
+
+#if DEBUG_COMBATSIM_LOG
+    std::ostringstream debug;
+    debug << BWAPI::WalkPosition(center);
+    if (!job.attacking && job.narrowChoke)
+    {
+        debug << " (defend " << BWAPI::WalkPosition(job.narrowChoke->center) << ")";
+    }
+    else if (job.narrowChoke)
     {
-        return execute<true>(targetPosition, this, unitsAndTargets, targets, detectors, attacking, narrowChoke);
+        debug << " (through " << BWAPI::WalkPosition(job.narrowChoke->center) << ")";
     }
+    debug << ": " << job.result.initialMine << "," << job.result.initialEnemy
+          << "-" << job.result.finalMine << "," << job.result.finalEnemy;
+    CherryVis::log() << debug.str();
+#endif
+
+    return job.result;
+}
 
-    return execute<false>(targetPosition, this, unitsAndTargets, targets, detectors, attacking);
+CombatSimResult UnitCluster::runCombatSim(BWAPI::Position targetPosition,
+                                          std::vector<std::pair<MyUnit, Unit>> &unitsAndTargets,
+                                          std::set<Unit> &targets,
+                                          std::set<MyUnit> &detectors,
+                                          bool attacking,
+                                          Choke *choke)
+{
+    return combatSimResult(*prepareCombatSim(targetPosition, unitsAndTargets, targets, detectors, attacking, choke));
 }
 
 void UnitCluster::addSimResult(CombatSimResult &simResult, bool attack)
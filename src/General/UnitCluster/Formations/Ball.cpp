@@ -139,16 +139,16 @@ bool UnitCluster::moveAsBall(BWAPI::Position targetPosition, std::set<MyUnit> &b
 
 #if DEBUG_UNIT_BOIDS
         std::ostringstream nodes;
-        auto &node = (*grid)[unit->getTilePosition()];
-        if (node.nextNode)
+        auto node = (*grid)[unit->getTilePosition()];
+        if (auto next = node.nextNode())
         {
-            nodes << "; nodes=[" << BWAPI::WalkPosition(node.nextNode->center());
-            if (node.nextNode->nextNode)
+            nodes << "; nodes=[" << BWAPI::WalkPosition(next.center());
+            if (auto second = next.nextNode())
             {
-                nodes << "," << BWAPI::WalkPosition(node.nextNode->nextNode->center());
-                if (node.nextNode->nextNode->nextNode)
+                nodes << "," << BWAPI::WalkPosition(second.center());
+                if (auto third = second.nextNode())
                 {
-                    nodes << "," << BWAPI::WalkPosition(node.nextNode->nextNode->nextNode->center());
+                    nodes << "," << BWAPI::WalkPosition(third.center());
                 }
             }
             nodes << "]";
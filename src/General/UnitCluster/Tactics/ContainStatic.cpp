@@ -164,19 +164,19 @@ void UnitCluster::containStatic(std::set<Unit> &enemyUnits,
             }
 
             // Get grid nodes if they are available
-            auto node = navigationGrid ? &(*navigationGrid)[myUnit->getTilePosition()] : nullptr;
-            auto nextNode = node ? node->nextNode : nullptr;
-            auto secondNode = nextNode ? nextNode->nextNode : nullptr;
+            auto node = navigationGrid ? (*navigationGrid)[myUnit->getTilePosition()] : NavigationGrid::GridNode();
+            auto nextNode = node ? node.nextNode() : NavigationGrid::GridNode();
+            auto secondNode = nextNode ? nextNode.nextNode() : NavigationGrid::GridNode();
 
             BWAPI::Position nextNodeCenter, secondNodeCenter;
             if (secondNode)
             {
-                nextNodeCenter = nextNode->center();
-                secondNodeCenter = secondNode->center();
+                nextNodeCenter = nextNode.center();
+                secondNodeCenter = secondNode.center();
 #if DEBUG_UNIT_BOIDS
                 CherryVis::log(myUnit->id) << "Contain (goal boid):"
-                                           << " nextNode=" << BWAPI::WalkPosition(nextNodeCenter) << " (" << nextNode->cost << ")"
-                                           << "; secondNode=" << BWAPI::WalkPosition(secondNodeCenter) << " (" << secondNode->cost << ")";
+                                           << " nextNode=" << BWAPI::WalkPosition(nextNodeCenter) << " (" << nextNode.cost() << ")"
+                                           << "; secondNode=" << BWAPI::WalkPosition(secondNodeCenter) << " (" << secondNode.cost() << ")";
 #endif
             }
             else
@@ -289,17 +289,17 @@ void UnitCluster::holdChoke(Choke *choke,
             if (distDiff > 0)
             {
                 // Use the grid node to get to the choke center
-                NavigationGrid::GridNode *currentNode;
-                NavigationGrid::GridNode *nextNode = nullptr;
-                if (targetPos == choke->center)
+                NavigationGrid::GridNode currentNode;
+                NavigationGrid::GridNode nextNode;
+                if (targetPos == choke->center && navigationGrid)
                 {
-                    currentNode = navigationGrid ? &(*navigationGrid)[myUnit->getTilePosition()] : nullptr;
-                    nextNode = currentNode ? currentNode->nextNode : nullptr;
+                    currentNode = (*navigationGrid)[myUnit->getTilePosition()];
+                    nextNode = currentNode.nextNode();
                 }
 
                 if (nextNode)
                 {
-                    scaled = Geo::ScaleVector(nextNode->center() - currentNode->center(), std::min(goalWeight, distDiff));
+                    scaled = Geo::ScaleVector(nextNode.center() - currentNode.center(), std::min(goalWeight, distDiff));
                 }
                 else
                 {
@@ -0,0 +1,68 @@
+#include "AllocationTracker.h"
+
+#if ALLOCATION_TRACKING_ENABLED
+
+#include <cstdlib>
+#include <new>
+
+namespace
+{
+    // Per thread, so allocations made by the writer and worker threads are not attributed to frame checkpoints
+    thread_local long long allocations = 0;
+    thread_local long long bytes = 0;
+}
+
+void *operator new(std::size_t size)
+{
+    allocations++;
+    bytes += (long long) size;
+
+    void *ptr = std::malloc(size == 0 ? 1 : size);
+    if (!ptr) throw std::bad_alloc();
+    return ptr;
+}
+
+void *operator new[](std::size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void *ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void *ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void *ptr, std::size_t) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void *ptr, std::size_t) noexcept
+{
+    std::free(ptr);
+}
+
+namespace AllocationTracker
+{
+    Counts current()
+    {
+        return {allocations, bytes};
+    }
+}
+
+#else
+
+namespace AllocationTracker
+{
+    Counts current()
+    {
+        return {};
+    }
+}
+
+#endif
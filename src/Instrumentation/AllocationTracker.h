@@ -0,0 +1,31 @@
+#pragma once
+
+// Set to true to count heap allocations and attribute them to the Timer checkpoints they are made in
+// This replaces the global operator new, so it is only available in instrumented builds
+#if INSTRUMENTATION_ENABLED
+#define ALLOCATION_TRACKING_ENABLED false
+#endif
+
+namespace AllocationTracker
+{
+    struct Counts
+    {
+        long long allocations = 0;
+        long long bytes = 0;
+
+        Counts operator-(const Counts &other) const
+        {
+            return {allocations - other.allocations, bytes - other.bytes};
+        }
+
+        Counts &operator+=(const Counts &other)
+        {
+            allocations += other.allocations;
+            bytes += other.bytes;
+            return *this;
+        }
+    };
+
+    // Returns the number and size of all allocations made by the calling thread since it started
+    Counts current();
+}
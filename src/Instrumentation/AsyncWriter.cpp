@@ -0,0 +1,256 @@
+#include "AsyncWriter.h"
+
+#if ASYNC_WRITER_ENABLED
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace AsyncWriter
+{
+    namespace
+    {
+        const size_t QUEUE_SIZE = 16384; // Must be a power of two
+
+        // Bounded multi-producer multi-consumer queue, see https://www.1024cores.net/home/lock-free-algorithms/queues/bounded-mpmc-queue
+        // We only have a single consumer, but log messages can be written from any thread
+        class TaskQueue
+        {
+        public:
+            TaskQueue() : cells(QUEUE_SIZE), enqueuePos(0), dequeuePos(0)
+            {
+                for (size_t i = 0; i < QUEUE_SIZE; i++)
+                {
+                    cells[i].sequence.store(i, std::memory_order_relaxed);
+                }
+            }
+
+            bool tryEnqueue(std::function<void()> &task)
+            {
+                size_t pos = enqueuePos.load(std::memory_order_relaxed);
+                while (true)
+                {
+                    auto &cell = cells[pos & (QUEUE_SIZE - 1)];
+                    size_t sequence = cell.sequence.load(std::memory_order_acquire);
+                    auto diff = (intptr_t) sequence - (intptr_t) pos;
+                    if (diff == 0)
+                    {
+                        if (enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                        {
+                            cell.task = std::move(task);
+                            cell.sequence.store(pos + 1, std::memory_order_release);
+                            return true;
+                        }
+                    }
+                    else if (diff < 0)
+                    {
+                        return false;
+                    }
+                    else
+                    {
+                        pos = enqueuePos.load(std::memory_order_relaxed);
+                    }
+                }
+            }
+
+            bool tryDequeue(std::function<void()> &task)
+            {
+                size_t pos = dequeuePos.load(std::memory_order_relaxed);
+                while (true)
+                {
+                    auto &cell = cells[pos & (QUEUE_SIZE - 1)];
+                    size_t sequence = cell.sequence.load(std::memory_order_acquire);
+                    auto diff = (intptr_t) sequence - (intptr_t) (pos + 1);
+                    if (diff == 0)
+                    {
+                        if (dequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                        {
+                            task = std::move(cell.task);
+                            cell.task = nullptr;
+                            cell.sequence.store(pos + QUEUE_SIZE, std::memory_order_release);
+                            return true;
+                        }
+                    }
+                    else if (diff < 0)
+                    {
+                        return false;
+                    }
+                    else
+                    {
+                        pos = dequeuePos.load(std::memory_order_relaxed);
+                    }
+                }
+            }
+
+        private:
+            struct Cell
+            {
+                std::atomic<size_t> sequence;
+                std::function<void()> task;
+            };
+
+            std::vector<Cell> cells;
+            alignas(64) std::atomic<size_t> enqueuePos;
+            alignas(64) std::atomic<size_t> dequeuePos;
+        };
+
+        std::unique_ptr<TaskQueue> queue;
+
+        // Only touched by the frame thread in start and stop; producers check running instead
+        // Not a std::thread value, as a joinable thread destroyed at process exit would terminate the process
+        std::thread *writerThread = nullptr;
+        std::thread::id writerThreadId;
+
+        // Producers register themselves in activeProducers before checking running, so stop can wait for any producer that
+        // saw the writer running to finish queueing its task before telling the writer to drain the queue and exit
+        std::atomic<bool> running = false;
+        std::atomic<int> activeProducers = 0;
+        std::atomic<bool> stopping = false;
+
+        std::atomic<size_t> queued = 0;
+        std::atomic<size_t> completed = 0;
+
+        // The writer sleeps on the condition variable when it runs out of work; producers only notify it when it is waiting
+        std::mutex wakeMutex;
+        std::condition_variable wake;
+        std::atomic<bool> waiting = false;
+
+        void runQueuedTasks()
+        {
+            std::function<void()> task;
+            while (queue->tryDequeue(task))
+            {
+                task();
+                task = nullptr;
+                completed.fetch_add(1);
+            }
+        }
+
+        void writerLoop()
+        {
+            while (true)
+            {
+                runQueuedTasks();
+
+                std::unique_lock<std::mutex> lock(wakeMutex);
+                waiting = true;
+
+                // A task may have been counted but not yet be in the queue, in which case we check again without waiting
+                if (completed.load() < queued.load())
+                {
+                    waiting = false;
+                    lock.unlock();
+                    std::this_thread::yield();
+                    continue;
+                }
+
+                if (stopping.load())
+                {
+                    // All producers have finished queueing, so this picks up anything queued since the last pass
+                    waiting = false;
+                    lock.unlock();
+                    runQueuedTasks();
+                    return;
+                }
+
+                wake.wait(lock);
+                waiting = false;
+            }
+        }
+
+        void wakeWriter()
+        {
+            if (!waiting.load()) return;
+
+            std::lock_guard<std::mutex> lock(wakeMutex);
+            wake.notify_one();
+        }
+    }
+
+    void start()
+    {
+        if (writerThread) return;
+
+        if (!queue) queue = std::make_unique<TaskQueue>();
+        stopping = false;
+        writerThread = new std::thread(writerLoop);
+        writerThreadId = writerThread->get_id();
+        running = true;
+    }
+
+    void stop()
+    {
+        if (!writerThread) return;
+
+        // New tasks now run synchronously; wait for producers that saw the writer running to finish queueing theirs
+        running = false;
+        while (activeProducers.load() > 0)
+        {
+            std::this_thread::yield();
+        }
+
+        stopping = true;
+        {
+            std::lock_guard<std::mutex> lock(wakeMutex);
+            wake.notify_one();
+        }
+        writerThread->join();
+        delete writerThread;
+        writerThread = nullptr;
+    }
+
+    void flush()
+    {
+        if (!running.load()) return;
+
+        auto target = queued.load();
+        while (completed.load() < target)
+        {
+            std::this_thread::yield();
+        }
+    }
+
+    void enqueue(std::function<void()> &&task)
+    {
+        activeProducers.fetch_add(1);
+
+        // Tasks queued by the writer thread itself (e.g. logging an error) are run immediately, as it cannot wait for itself
+        if (!running.load() || std::this_thread::get_id() == writerThreadId)
+        {
+            activeProducers.fetch_sub(1);
+            task();
+            return;
+        }
+
+        queued.fetch_add(1);
+        while (!queue->tryEnqueue(task))
+        {
+            wakeWriter();
+            std::this_thread::yield();
+        }
+        activeProducers.fetch_sub(1);
+
+        wakeWriter();
+    }
+}
+
+#else
+
+namespace AsyncWriter
+{
+    void start() {}
+
+    void stop() {}
+
+    void flush() {}
+
+    void enqueue(std::function<void()> &&task)
+    {
+        task();
+    }
+}
+
+#endif
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <functional>
+
+#if LOGGING_ENABLED || INSTRUMENTATION_ENABLED
+
+// Set to false to perform all instrumentation serialization and file I/O synchronously on the calling thread
+// Useful when debugging crashes, as records still in the queue are lost if the process dies
+#define ASYNC_WRITER_ENABLED true
+#endif
+
+/*
+ * Runs instrumentation output tasks (JSON serialization, compression, file I/O) on a background thread, so they do not
+ * count against our frame time.
+ *
+ * Tasks are queued through a bounded lock-free queue and run in the order they were queued. If the queue is full, the
+ * caller waits for space, so no output is ever dropped. When the writer thread is not running, tasks run immediately on
+ * the calling thread.
+ */
+namespace AsyncWriter
+{
+    // Starts the writer thread if it is not already running; called from the frame thread
+    void start();
+
+    // Runs all queued tasks and stops the writer thread; called from the frame thread
+    void stop();
+
+    // Blocks until all tasks queued so far have run
+    void flush();
+
+    void enqueue(std::function<void()> &&task);
+}
@@ -2,9 +2,11 @@
 
 #if CHERRYVIS_ENABLED
 #include "Log.h"
+#include "AsyncWriter.h"
 
 #include <utility>
 #include <filesystem>
+#include <atomic>
 
 #if INSTRUMENTATION_ENABLED_VERBOSE
 #include <zstdstream/zstdstream.hpp>
@@ -23,7 +25,8 @@ namespace CherryVis
     {
 #if CHERRYVIS_ENABLED
 
-        bool disabled = false;
+        // Set from the writer thread if writing fails
+        std::atomic<bool> disabled = false;
 
         enum DataFileType {
             Array,
@@ -71,21 +74,61 @@ namespace CherryVis
                 return result;
             }
 
-            void writeEntry(const nlohmann::json &entry)
+            // Queues the entry to be serialized and written on the writer thread
+            void writeEntry(nlohmann::json entry)
             {
+                AsyncWriter::enqueue([this, entry = std::move(entry), frame = BWAPI::Broodwar->getFrameCount()]()
+                                     {
+                                         write(entry, frame);
+                                     });
+            }
+
+            void close()
+            {
+                AsyncWriter::enqueue([this]()
+                                     {
+                                         closePart();
+                                     });
+            }
+
+            void flush()
+            {
+                AsyncWriter::enqueue([this]()
+                                     {
+                                         if (count == 0) return;
+                                         stream->flush();
+                                     });
+            }
+
+        private:
+            std::string filename;
+            DataFileType type;
+            int lastFrame;
+            int partitionedObjectSize;
+            int framesPerPartition;
+            int currentPartition;
+            int count;
+            STREAM *stream{};
+
+            // The following run on the writer thread, so use the frame the entry was queued on instead of the current frame
+
+            void write(const nlohmann::json &entry, int frame)
+            {
+                if (disabled) return;
+
                 try
                 {
                     if (count * partitionedObjectSize >= 26214400)
                     {
-                        close();
+                        closePart();
                     }
 
                     if (framesPerPartition > 0)
                     {
-                        int partition = (BWAPI::Broodwar->getFrameCount() / framesPerPartition) * framesPerPartition;
+                        int partition = (frame / framesPerPartition) * framesPerPartition;
                         if (partition != currentPartition)
                         {
-                            close();
+                            closePart();
                         }
 
                         currentPartition = partition;
@@ -93,7 +136,7 @@ namespace CherryVis
 
                     if (count == 0)
                     {
-                        createPart();
+                        createPart(frame);
                     }
                     else
                     {
@@ -103,18 +146,18 @@ namespace CherryVis
                                 (*stream) << ",";
                                 break;
                             case ArrayPerFrame:
-                                if (lastFrame == BWAPI::Broodwar->getFrameCount())
+                                if (lastFrame == frame)
                                 {
                                     (*stream) << ",";
                                 }
                                 else
                                 {
-                                    (*stream) << "],\"" << BWAPI::Broodwar->getFrameCount() << "\":[";
-                                    lastFrame = BWAPI::Broodwar->getFrameCount();
+                                    (*stream) << "],\"" << frame << "\":[";
+                                    lastFrame = frame;
                                 }
                                 break;
                             case ObjectPerFrame:
-                                (*stream) << ",\"" << BWAPI::Broodwar->getFrameCount() << "\":";
+                                (*stream) << ",\"" << frame << "\":";
                                 break;
                         }
                     }
@@ -144,7 +187,7 @@ namespace CherryVis
                 }
             }
 
-            void close()
+            void closePart()
             {
                 if (count == 0) return;
 
@@ -180,33 +223,17 @@ namespace CherryVis
                 }
             }
 
-            void flush()
-            {
-                if (count == 0) return;
-                stream->flush();
-            }
-
-        private:
-            std::string filename;
-            DataFileType type;
-            int lastFrame;
-            int partitionedObjectSize;
-            int framesPerPartition;
-            int currentPartition;
-            int count;
-            STREAM *stream{};
-
-            void createPart()
+            void createPart(int frame)
             {
                 try
                 {
-                    int startFrame = BWAPI::Broodwar->getFrameCount();
+                    int startFrame = frame;
                     std::ostringstream filenameBuilder;
                     filenameBuilder << filename;
-                    if (partitionedObjectSize > 0) filenameBuilder << "_" << BWAPI::Broodwar->getFrameCount();
+                    if (partitionedObjectSize > 0) filenameBuilder << "_" << frame;
                     if (framesPerPartition > 0)
                     {
-                        startFrame = (BWAPI::Broodwar->getFrameCount() / framesPerPartition) * framesPerPartition;
+                        startFrame = (frame / framesPerPartition) * framesPerPartition;
                         filenameBuilder << "_" << startFrame;
                     }
                     filenameBuilder << FILE_EXTENSION;
@@ -221,10 +248,10 @@ namespace CherryVis
                             (*stream) << "[";
                             break;
                         case ArrayPerFrame:
-                            (*stream) << "{\"" << BWAPI::Broodwar->getFrameCount() << "\":[";
+                            (*stream) << "{\"" << frame << "\":[";
                             break;
                         case ObjectPerFrame:
-                            (*stream) << "{\"" << BWAPI::Broodwar->getFrameCount() << "\":";
+                            (*stream) << "{\"" << frame << "\":";
                             break;
                     }
                 }
@@ -276,7 +303,7 @@ namespace CherryVis
                                          });
         }
 
-        void draw(const nlohmann::json &drawCommand, int unitId)
+        void draw(nlohmann::json drawCommand, int unitId)
         {
             auto drawCommandsFileIt = unitIdToDrawCommandsFile.find(unitId);
             if (drawCommandsFileIt == unitIdToDrawCommandsFile.end())
@@ -297,7 +324,7 @@ namespace CherryVis
                         std::make_tuple(filenameBuilder.str(), DataFileType::ArrayPerFrame, 0, (unitId != -1) ? 0 : 5000)).first;
             }
 
-            drawCommandsFileIt->second.writeEntry(drawCommand);
+            drawCommandsFileIt->second.writeEntry(std::move(drawCommand));
         }
 
 #endif
@@ -347,6 +374,9 @@ namespace CherryVis
 #if CHERRYVIS_ENABLED
         if (disabled) return;
 
+        // Queued writes reference the data files we are about to clear
+        AsyncWriter::flush();
+
         boardUpdatesFile = std::make_unique<DataFile>("board_updates", DataFileType::ObjectPerFrame);
         frameBoardUpdates = nlohmann::json::object();
         frameHasBoardUpdates = false;
@@ -483,7 +513,7 @@ namespace CherryVis
         std::ostringstream filenameBuilder;
         filenameBuilder << "heatmap_" << key;
         auto heatmap = heatmapNameToDataFile.try_emplace(key, filenameBuilder.str(), DataFileType::ObjectPerFrame, sizeX * sizeY);
-        heatmap.first->second.writeEntry(frameData);
+        heatmap.first->second.writeEntry(std::move(frameData));
 #endif
     }
 
@@ -533,7 +563,7 @@ namespace CherryVis
 
         if (frameHasBoardUpdates)
         {
-            boardUpdatesFile->writeEntry(frameBoardUpdates);
+            boardUpdatesFile->writeEntry(std::move(frameBoardUpdates));
             frameBoardUpdates = nlohmann::json::object();
             frameHasBoardUpdates = false;
         }
@@ -571,6 +601,9 @@ namespace CherryVis
 #if CHERRYVIS_ENABLED
         if (disabled) return;
 
+        // Data file parts are created on the writer thread, so let it catch up before building the index
+        AsyncWriter::flush();
+
         std::vector<nlohmann::json> heatmaps;
         for (auto &heatmapNameAndDataFile : heatmapNameToDataFile)
         {
@@ -675,6 +708,8 @@ namespace CherryVis
         {
             Log::Get() << "Exception caught writing trace file: " << ex.what();
         }
+
+        AsyncWriter::flush();
 #endif
     }
 }
@@ -1,4 +1,5 @@
 #include "Log.h"
+#include "AsyncWriter.h"
 
 #if LOGGING_ENABLED
 
@@ -24,17 +25,13 @@ namespace Log
 #endif
         std::vector<std::string> logFiles;
 
-        std::string logFileName(const std::string &base, bool csv = false)
+        std::string logFileName(const std::string &base, const std::string &extension)
         {
             std::ostringstream filename;
             filename << "bwapi-data/write/" << base;
             auto tt = std::chrono::system_clock::to_time_t(startTime);
             auto tm = std::localtime(&tt);
-            filename << "_" << std::put_time(tm, "%Y%m%d_%H%M%S");
-            if (csv)
-                filename << ".csv";
-            else
-                filename << ".txt";
+            filename << "_" << std::put_time(tm, "%Y%m%d_%H%M%S") << extension;
 
             logFiles.push_back(filename.str());
 
@@ -76,16 +73,21 @@ namespace Log
 
         if (*refCount == 0)
         {
-            if (outputToConsole)
+            if (outputToConsole || logFile)
             {
-                std::cout << os->str() << std::endl;
-            }
-
-            if (logFile)
-            {
-                (*os) << "\n";
-                (*logFile) << os->str();
-                logFile->flush();
+                AsyncWriter::enqueue([message = os->str(), logFile = logFile, outputToConsole = outputToConsole]()
+                                     {
+                                         if (outputToConsole)
+                                         {
+                                             std::cout << message << std::endl;
+                                         }
+
+                                         if (logFile)
+                                         {
+                                             (*logFile) << message << "\n";
+                                             logFile->flush();
+                                         }
+                                     });
             }
 
             delete os;
@@ -97,6 +99,9 @@ namespace Log
     {
         startTime = std::chrono::system_clock::now();
 
+        // Make sure everything written to the previous game's files is out before closing them
+        AsyncWriter::flush();
+
         try
         {
             if (log)
@@ -149,7 +154,7 @@ namespace Log
         if (!log)
         {
             log = new std::ofstream();
-            log->open(logFileName("Stardust_log"), std::ofstream::trunc);
+            log->open(logFileName("Stardust_log", ".txt"), std::ofstream::trunc);
         }
 
         return {log, isOutputtingToConsole};
@@ -163,7 +168,7 @@ namespace Log
         if (!debugLog)
         {
             debugLog = new std::ofstream();
-            debugLog->open(logFileName("Stardust_debug"), std::ofstream::trunc);
+            debugLog->open(logFileName("Stardust_debug", ".txt"), std::ofstream::trunc);
         }
 
         return {debugLog, false};
@@ -180,7 +185,7 @@ namespace Log
         if (!csvFiles[name])
         {
             csvFiles[name] = new std::ofstream();
-            csvFiles[name]->open(logFileName(name, true), std::ofstream::trunc);
+            csvFiles[name]->open(logFileName(name, ".csv"), std::ofstream::trunc);
         }
 
         return {csvFiles[name], false, true};
@@ -189,6 +194,11 @@ namespace Log
 #endif
     }
 
+    std::string FileName(const std::string &base, const std::string &extension)
+    {
+        return logFileName(base, extension);
+    }
+
     std::vector<std::string> &LogFiles()
     {
         return logFiles;
@@ -228,6 +238,11 @@ namespace Log
         return LogWrapper();
     }
 
+    std::string FileName(const std::string &base, const std::string &extension)
+    {
+        return "bwapi-data/write/" + base + extension;
+    }
+
     std::vector<std::string> &LogFiles()
     {
         return logFiles;
@@ -65,6 +65,9 @@ namespace Log
 
     LogWrapper Csv(const std::string &name);
 
+    // Returns the path of a new file in the write directory named like the log files, e.g. for other instrumentation output
+    std::string FileName(const std::string &base, const std::string &extension);
+
     // Returns a list of the paths of all the log files we have written in this game
     std::vector<std::string> &LogFiles();
 }
\ No newline at end of file
@@ -1,10 +1,23 @@
 ﻿#include "Timer.h"
 #include "Common.h"
+#include "AllocationTracker.h"
 
-#include <chrono>
+#include <bit>
+#include <cmath>
 
 #define DEBUG_LOG_EACH_CHECKPOINT false
 
+// Set to true to stream all frames, checkpoints and zones to a Chrome trace-event JSON file in bwapi-data/write
+// The file can be opened in chrome://tracing or https://ui.perfetto.dev
+#if INSTRUMENTATION_ENABLED
+#define WRITE_TRACE_EVENTS false
+#endif
+
+#if WRITE_TRACE_EVENTS
+#include <fstream>
+#include "AsyncWriter.h"
+#endif
+
 namespace Timer
 {
     namespace
@@ -23,22 +36,277 @@ namespace Timer
         const int DEBUG_CUTOFF = 45;
 #endif
 
+        // Frames over this many milliseconds count against the tournament frame limits
+        const int TOURNAMENT_FRAME_LIMIT = 55;
+
+        // Log-linear histogram of durations in microseconds
+        // Values below 32us get their own bucket, above that each power of two is split into 16 buckets, giving ~6% precision
+        class Histogram
+        {
+        public:
+            void add(long long us)
+            {
+                if (us < 0) us = 0;
+
+                count++;
+                total += us;
+                max = std::max(max, us);
+
+                auto bucket = bucketFor(us);
+                if (bucket >= buckets.size()) buckets.resize(bucket + 1, 0);
+                buckets[bucket]++;
+            }
+
+            [[nodiscard]] long long percentile(double p) const
+            {
+                if (count == 0) return 0;
+
+                auto target = (long long) std::ceil(p * (double) count);
+                long long seen = 0;
+                for (size_t i = 0; i < buckets.size(); i++)
+                {
+                    seen += buckets[i];
+                    if (seen >= target) return std::min(max, bucketUpperBound(i));
+                }
+
+                return max;
+            }
+
+            long long count = 0;
+            long long total = 0;
+            long long max = 0;
+
+        private:
+            std::vector<long long> buckets;
+
+            static size_t bucketFor(long long us)
+            {
+                if (us < 32) return us;
+
+                int msb = std::bit_width((unsigned long long) us) - 1;
+                int shift = msb - 4;
+                return 32 + (msb - 5) * 16 + ((us >> shift) - 16);
+            }
+
+            static long long bucketUpperBound(size_t bucket)
+            {
+                if (bucket < 32) return (long long) bucket;
+
+                int msb = (int) (bucket - 32) / 16 + 5;
+                int shift = msb - 4;
+                long long mantissa = (long long) ((bucket - 32) % 16) + 16;
+                return ((mantissa + 1) << shift) - 1;
+            }
+        };
+
+        struct ZoneData
+        {
+            std::string path;
+            std::unordered_map<const char *, int> children;
+            long long frameTotal = 0;
+            bool enteredThisFrame = false;
+            Histogram histogram;
+        };
+
         std::string overallLabel;
         std::chrono::steady_clock::time_point startPoint;
         std::chrono::steady_clock::time_point lastCheckpoint;
         std::vector<std::pair<std::string, long long>> checkpoints;
 
+        // Game-long statistics for the overall timer and each checkpoint, in order of first appearance
+        std::vector<std::pair<std::string, Histogram>> checkpointHistograms;
+        std::unordered_map<std::string, size_t> checkpointHistogramIndices;
+        int framesOverTournamentLimit;
+
+        // Zone tree; index 0 is the root, which is never timed itself
+        std::vector<ZoneData> zones;
+        int currentZone;
+
+#if ALLOCATION_TRACKING_ENABLED
+        AllocationTracker::Counts frameAllocationsStart;
+        AllocationTracker::Counts lastCheckpointAllocations;
+        std::vector<std::pair<std::string, AllocationTracker::Counts>> checkpointAllocations;
+        std::map<std::string, AllocationTracker::Counts> gameAllocations;
+
+        void writeAllocations(std::ostringstream &msg, const std::string &label, const AllocationTracker::Counts &counts)
+        {
+            msg << "\n" << label << ": " << counts.allocations << " allocations, " << counts.bytes << " bytes";
+        }
+#endif
+
+#if WRITE_TRACE_EVENTS
+        // The file is only touched by writer tasks, which run in order, so the frame thread only tracks whether it is open
+        std::chrono::steady_clock::time_point traceStartPoint;
+        std::ofstream *traceFile;
+        bool traceFileOpen;
+        bool firstTraceEvent;
+
+        void closeTraceFile()
+        {
+            if (!traceFileOpen) return;
+            traceFileOpen = false;
+
+            AsyncWriter::enqueue([]()
+                                 {
+                                     (*traceFile) << "\n]\n";
+                                     traceFile->close();
+                                     delete traceFile;
+                                     traceFile = nullptr;
+                                 });
+        }
+
+        void writeJsonString(std::ostringstream &out, const std::string &value)
+        {
+            out << '"';
+            for (char c : value)
+            {
+                switch (c)
+                {
+                    case '"':
+                        out << "\\\"";
+                        break;
+                    case '\\':
+                        out << "\\\\";
+                        break;
+                    case '\n':
+                        out << "\\n";
+                        break;
+                    case '\t':
+                        out << "\\t";
+                        break;
+                    default:
+                        if ((unsigned char)c < 0x20)
+                        {
+                            out << "\\u00" << "0123456789abcdef"[(c >> 4) & 0xf] << "0123456789abcdef"[c & 0xf];
+                        }
+                        else
+                        {
+                            out << c;
+                        }
+                }
+            }
+            out << '"';
+        }
+
+        // Writes a complete event; the viewer nests events on the same thread by their time ranges
+        // The event is formatted here and written to the file on the writer thread
+        void writeTraceEvent(const std::string &name,
+                             const char *category,
+                             std::chrono::steady_clock::time_point start,
+                             std::chrono::steady_clock::time_point end,
+                             int frame = -1)
+        {
+            std::ostringstream event;
+            if (!traceFileOpen)
+            {
+                traceFileOpen = true;
+                firstTraceEvent = true;
+                AsyncWriter::enqueue([filename = Log::FileName("Stardust_trace", ".json")]()
+                                     {
+                                         traceFile = new std::ofstream();
+                                         traceFile->open(filename, std::ofstream::trunc);
+                                         (*traceFile) << "[";
+                                     });
+            }
+
+            if (!firstTraceEvent) event << ",";
+            firstTraceEvent = false;
+
+            event << "\n{\"name\":";
+            writeJsonString(event, name);
+            event << ",\"cat\":\"" << category
+                  << "\",\"ph\":\"X\",\"pid\":1,\"tid\":1"
+                  << ",\"ts\":" << std::chrono::duration_cast<std::chrono::microseconds>(start - traceStartPoint).count()
+                  << ",\"dur\":" << std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+            if (frame != -1)
+            {
+                event << ",\"args\":{\"frame\":" << frame << "}";
+            }
+            event << "}";
+
+            AsyncWriter::enqueue([event = event.str()]()
+                                 {
+                                     (*traceFile) << event;
+                                 });
+        }
+#endif
+
         bool sortCheckpoints(std::pair<std::string, long long> &first, std::pair<std::string, long long> &second)
         {
             return first.second > second.second;
         }
+
+        Histogram &checkpointHistogram(const std::string &label)
+        {
+            auto it = checkpointHistogramIndices.find(label);
+            if (it != checkpointHistogramIndices.end()) return checkpointHistograms[it->second].second;
+
+            checkpointHistogramIndices[label] = checkpointHistograms.size();
+            return checkpointHistograms.emplace_back(label, Histogram()).second;
+        }
+
+        int childZone(int parent, const char *label)
+        {
+            auto it = zones[parent].children.find(label);
+            if (it != zones[parent].children.end()) return it->second;
+
+            int index = (int) zones.size();
+            auto &zone = zones.emplace_back();
+            zone.path = parent == 0 ? label : (zones[parent].path + "/" + label);
+            zones[parent].children[label] = index;
+            return index;
+        }
+
+        void resetZones()
+        {
+            zones.clear();
+            zones.emplace_back();
+            currentZone = 0;
+        }
+
+        Statistics toStatistics(const std::string &label, const Histogram &histogram)
+        {
+            return {
+                    label,
+                    histogram.count,
+                    histogram.count == 0 ? 0 : histogram.total / histogram.count,
+                    histogram.percentile(0.5),
+                    histogram.percentile(0.95),
+                    histogram.percentile(0.99),
+                    histogram.max
+            };
+        }
+    }
+
+    void initialize()
+    {
+        checkpoints.clear();
+        checkpointHistograms.clear();
+        checkpointHistogramIndices.clear();
+        framesOverTournamentLimit = 0;
+        resetZones();
+
+#if ALLOCATION_TRACKING_ENABLED
+        checkpointAllocations.clear();
+        gameAllocations.clear();
+#endif
+
+#if WRITE_TRACE_EVENTS
+        closeTraceFile();
+        traceStartPoint = std::chrono::steady_clock::now();
+#endif
     }
 
     void start(const std::string &label)
     {
         overallLabel = label;
         checkpoints.clear();
-        startPoint = lastCheckpoint = std::chrono::high_resolution_clock::now();
+        startPoint = lastCheckpoint = std::chrono::steady_clock::now();
+
+#if ALLOCATION_TRACKING_ENABLED
+        checkpointAllocations.clear();
+        frameAllocationsStart = lastCheckpointAllocations = AllocationTracker::current();
+#endif
     }
 
     void checkpoint(const std::string &label)
@@ -46,14 +314,66 @@ namespace Timer
 #if DEBUG_LOG_EACH_CHECKPOINT
         Log::Debug() << label;
 #endif
-        auto now = std::chrono::high_resolution_clock::now();
+#if ALLOCATION_TRACKING_ENABLED
+        auto allocations = AllocationTracker::current();
+        checkpointAllocations.emplace_back(label, allocations - lastCheckpointAllocations);
+        lastCheckpointAllocations = allocations;
+#endif
+
+        auto now = std::chrono::steady_clock::now();
         checkpoints.emplace_back(label, std::chrono::duration_cast<std::chrono::microseconds>(now - lastCheckpoint).count());
+#if WRITE_TRACE_EVENTS
+        writeTraceEvent(label, "checkpoint", lastCheckpoint, now);
+#endif
         lastCheckpoint = now;
     }
 
     void stop(bool forceOutput)
     {
-        long long overall = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::high_resolution_clock::now() - startPoint).count();
+        auto now = std::chrono::steady_clock::now();
+        auto overallMicroseconds = std::chrono::duration_cast<std::chrono::microseconds>(now - startPoint).count();
+#if WRITE_TRACE_EVENTS
+        writeTraceEvent(overallLabel, "frame", startPoint, now, currentFrame);
+#endif
+        long long overall = overallMicroseconds / 1000;
+
+        // Record the game-long statistics
+        checkpointHistogram(overallLabel).add(overallMicroseconds);
+        if (overall > TOURNAMENT_FRAME_LIMIT) framesOverTournamentLimit++;
+        for (auto &checkpoint : checkpoints)
+        {
+            checkpointHistogram(checkpoint.first).add(checkpoint.second);
+        }
+        for (auto &zone : zones)
+        {
+            if (!zone.enteredThisFrame) continue;
+
+            zone.histogram.add(zone.frameTotal);
+            zone.frameTotal = 0;
+            zone.enteredThisFrame = false;
+        }
+
+#if ALLOCATION_TRACKING_ENABLED
+        {
+            auto frameAllocations = AllocationTracker::current() - frameAllocationsStart;
+            gameAllocations[overallLabel] += frameAllocations;
+
+            std::ostringstream allocationsMsg;
+            allocationsMsg << overallLabel << " allocations: " << frameAllocations.allocations << " (" << frameAllocations.bytes << " bytes)";
+            for (auto &labelAndAllocations : checkpointAllocations)
+            {
+                gameAllocations[labelAndAllocations.first] += labelAndAllocations.second;
+                if (labelAndAllocations.second.allocations == 0) continue;
+
+                allocationsMsg << ", " << labelAndAllocations.first << ": " << labelAndAllocations.second.allocations
+                               << " (" << labelAndAllocations.second.bytes << " bytes)";
+            }
+            Log::Debug() << allocationsMsg.str();
+
+            CherryVis::setBoardValue("allocations", (std::ostringstream() << frameAllocations.allocations).str());
+            CherryVis::setBoardValue("allocationBytes", (std::ostringstream() << frameAllocations.bytes).str());
+        }
+#endif
 
         if (forceOutput || overall > DEBUG_CUTOFF)
         {
@@ -84,4 +404,81 @@ namespace Timer
                 Log::Get() << msg.str();
         }
     }
+
+    std::vector<Statistics> statistics()
+    {
+        std::vector<Statistics> result;
+        for (auto &labelAndHistogram : checkpointHistograms)
+        {
+            result.push_back(toStatistics(labelAndHistogram.first, labelAndHistogram.second));
+        }
+
+        // Zones are added depth-first so nested zones appear under their parents
+        if (zones.empty()) return result;
+        std::vector<int> stack;
+        for (auto &child : zones[0].children) stack.push_back(child.second);
+        while (!stack.empty())
+        {
+            auto &zone = zones[stack.back()];
+            stack.pop_back();
+
+            result.push_back(toStatistics(zone.path, zone.histogram));
+            for (auto &child : zone.children) stack.push_back(child.second);
+        }
+
+        return result;
+    }
+
+    void writeSummary()
+    {
+        std::ostringstream msg;
+        msg << "Timer summary; " << framesOverTournamentLimit << " frame(s) over " << TOURNAMENT_FRAME_LIMIT << "ms";
+
+        for (auto &stats : statistics())
+        {
+            msg << "\n" << stats.label
+                << ": n=" << stats.count
+                << ", mean=" << stats.mean << "us"
+                << ", p50=" << stats.p50 << "us"
+                << ", p95=" << stats.p95 << "us"
+                << ", p99=" << stats.p99 << "us"
+                << ", max=" << stats.max << "us";
+        }
+
+        Log::Get() << msg.str();
+
+#if ALLOCATION_TRACKING_ENABLED
+        std::ostringstream allocationsMsg;
+        allocationsMsg << "Allocation summary";
+        for (auto &labelAndAllocations : gameAllocations)
+        {
+            writeAllocations(allocationsMsg, labelAndAllocations.first, labelAndAllocations.second);
+        }
+        Log::Get() << allocationsMsg.str();
+#endif
+
+#if WRITE_TRACE_EVENTS
+        closeTraceFile();
+#endif
+    }
+
+    Zone::Zone(const char *label)
+            : parent(currentZone)
+            , startPoint(std::chrono::steady_clock::now())
+    {
+        if (zones.empty()) resetZones();
+        currentZone = childZone(parent, label);
+    }
+
+    Zone::~Zone()
+    {
+        auto now = std::chrono::steady_clock::now();
+        auto &zone = zones[currentZone];
+        zone.frameTotal += std::chrono::duration_cast<std::chrono::microseconds>(now - startPoint).count();
+#if WRITE_TRACE_EVENTS
+        writeTraceEvent(zone.path, "zone", startPoint, now);
+#endif
+        zone.enteredThisFrame = true;
+        currentZone = parent;
+    }
 }
@@ -1,12 +1,54 @@
 #pragma once
 
 #include <string>
+#include <vector>
+#include <chrono>
 
 namespace Timer
 {
+    void initialize();
+
     void start(const std::string &label);
 
     void checkpoint(const std::string &label);
 
     void stop(bool forceOutput = false);
+
+    // Game-long frame time distribution of a checkpoint or zone, in microseconds
+    struct Statistics
+    {
+        std::string label;
+        long long count;
+        long long mean;
+        long long p50;
+        long long p95;
+        long long p99;
+        long long max;
+    };
+
+    // Returns the statistics for the overall timer, each checkpoint and each zone
+    std::vector<Statistics> statistics();
+
+    // Writes the game-long frame time distribution of each checkpoint and zone to the log and closes the trace file, if enabled
+    void writeSummary();
+
+    // Times a block of code until it goes out of scope.
+    // Zones can be nested and are accumulated over the frame, so a zone entered multiple times in a frame (e.g. once per squad) is
+    // recorded as the sum of its durations.
+    // The label must be a string literal or otherwise outlive the game.
+    class Zone
+    {
+    public:
+        explicit Zone(const char *label);
+
+        ~Zone();
+
+        Zone(const Zone &) = delete;
+
+        Zone &operator=(const Zone &) = delete;
+
+    private:
+        int parent;
+        std::chrono::steady_clock::time_point startPoint;
+    };
 }
@@ -19,9 +19,11 @@
 #include "Units.h"
 #include "PathFinding.h"
 #include "Geo.h"
+#include "FrameScheduler.h"
 #include "Opponent.h"
 
 #include "NoGoAreas.h"
+#include "MapDataCache.h"
 
 #if INSTRUMENTATION_ENABLED
 #define CVIS_HEATMAPS true
@@ -56,6 +58,7 @@ namespace Map
         std::vector<bool> islandTiles;
 
         std::vector<int> tileLastSeen;
+        bool tileLastSeenTopHalf;
 
 #if CVIS_HEATMAPS
         std::vector<long> power;
@@ -144,14 +147,20 @@ namespace Map
 
         int closestBaseDistance(Base *base, const std::set<Base *> &otherBases)
         {
-            int closestDistance = -1;
+            std::vector<BWAPI::Position> otherBasePositions;
+            otherBasePositions.reserve(otherBases.size());
             for (auto otherBase : otherBases)
             {
-                int dist = PathFinding::GetGroundDistance(
-                        base->getPosition(),
-                        otherBase->getPosition(),
-                        BWAPI::UnitTypes::Protoss_Probe,
-                        PathFinding::PathFindingOptions::UseNearestBWEMArea);
+                otherBasePositions.push_back(otherBase->getPosition());
+            }
+
+            int closestDistance = -1;
+            for (int dist : PathFinding::GetGroundDistances(
+                    base->getPosition(),
+                    otherBasePositions,
+                    BWAPI::UnitTypes::Protoss_Probe,
+                    PathFinding::PathFindingOptions::UseNearestBWEMArea))
+            {
                 if (dist >= 0 && (dist < closestDistance || closestDistance == -1))
                     closestDistance = dist;
             }
@@ -168,22 +177,32 @@ namespace Map
             // via map-specific overrides
 
             // Get the closest base
-            Base *bestNatural = nullptr;
-            int bestDist = INT_MAX;
+            std::vector<Base *> candidates;
+            std::vector<BWAPI::Position> candidatePositions;
             for (auto &base : bases)
             {
                 if (base->getTilePosition() == startLocation) continue;
                 if (base->gas == 0) continue;
 
-                int dist = PathFinding::GetGroundDistance(
-                        startPosition,
-                        base->getPosition(),
-                        BWAPI::UnitTypes::Protoss_Probe,
-                        PathFinding::PathFindingOptions::UseNearestBWEMArea);
+                candidates.push_back(base);
+                candidatePositions.push_back(base->getPosition());
+            }
+
+            auto distances = PathFinding::GetGroundDistances(
+                    startPosition,
+                    candidatePositions,
+                    BWAPI::UnitTypes::Protoss_Probe,
+                    PathFinding::PathFindingOptions::UseNearestBWEMArea);
+
+            Base *bestNatural = nullptr;
+            int bestDist = INT_MAX;
+            for (size_t i = 0; i < candidates.size(); i++)
+            {
+                int dist = distances[i];
                 if (dist == -1 || dist > bestDist) continue;
 
                 bestDist = dist;
-                bestNatural = base;
+                bestNatural = candidates[i];
             }
             if (!bestNatural) return nullptr;
 
@@ -897,6 +916,8 @@ namespace Map
         mapWidthPixels = mapWidth * 32;
         mapHeightPixels = mapHeight * 32;
 
+        MapDataCache::initialize();
+
         if (_mapSpecificOverride)
         {
             delete _mapSpecificOverride;
@@ -922,6 +943,7 @@ namespace Map
         islandTiles.clear();
         tileLastSeen.clear();
         tileLastSeen.assign(mapWidth * mapHeight, -1);
+        tileLastSeenTopHalf = true;
 
         NoGoAreas::initialize();
 
@@ -1202,28 +1224,34 @@ namespace Map
     void update()
     {
         // Update the last seen frame for all visible tiles
-        // This is fairly expensive and we don't need super high resolution updates, so we split the update over two frames
-        int startY, endY;
-        if (currentFrame % 2 == 0)
-        {
-            startY = 0;
-            endY = mapHeight >> 1;
-        }
-        else
-        {
-            startY = mapHeight >> 1;
-            endY = mapHeight;
-        }
-        for (int y = startY; y < endY; y++)
+        // This is fairly expensive and we don't need super high resolution updates, so we split the update over two runs and allow
+        // it to be deferred on slow frames
+        FrameScheduler::run("Map::updateTileLastSeen", 2, []()
         {
-            for (int x = 0; x < mapWidth; x++)
+            int startY, endY;
+            if (tileLastSeenTopHalf)
             {
-                if (BWAPI::Broodwar->isVisible(x, y))
+                startY = 0;
+                endY = mapHeight >> 1;
+            }
+            else
+            {
+                startY = mapHeight >> 1;
+                endY = mapHeight;
+            }
+            tileLastSeenTopHalf = !tileLastSeenTopHalf;
+
+            for (int y = startY; y < endY; y++)
+            {
+                for (int x = 0; x < mapWidth; x++)
                 {
-                    tileLastSeen[x + y * mapWidth] = currentFrame;
+                    if (BWAPI::Broodwar->isVisible(x, y))
+                    {
+                        tileLastSeen[x + y * mapWidth] = currentFrame;
+                    }
                 }
             }
-        }
+        });
 
         // Update bases, base scouting and resource depot
         for (auto &base : bases)
@@ -0,0 +1,204 @@
+#include "MapDataCache.h"
+
+#include <cstring>
+#include <fstream>
+#include <filesystem>
+
+// Bump when the format or the way any cached data is computed changes, so stale caches are ignored
+#define MAP_DATA_CACHE_VERSION 1
+
+// Entries not used in the current game are dropped from the written cache once it reaches this size
+#define MAP_DATA_CACHE_MAX_SIZE_MB 64
+
+namespace MapDataCache
+{
+    namespace
+    {
+        std::vector<std::string> dataLoadPaths = {
+                "bwapi-data/AI/",
+                "bwapi-data/read/",
+                "bwapi-data/write/"
+        };
+        std::string dataWritePath = "bwapi-data/write/";
+
+        const char magic[4] = {'S', 'D', 'M', 'C'};
+
+        struct Entry
+        {
+            std::vector<unsigned char> data;
+            bool usedThisGame;
+        };
+
+        std::map<std::pair<std::string, unsigned long long>, Entry> entries;
+        bool added;
+
+        std::string cacheFilename(bool writing = false)
+        {
+            if (writing)
+            {
+                return (std::ostringstream() << dataWritePath << BWAPI::Broodwar->mapHash() << "_mapDataCache.bin").str();
+            }
+
+            for (auto &path : dataLoadPaths)
+            {
+                auto filename = (std::ostringstream() << path << BWAPI::Broodwar->mapHash() << "_mapDataCache.bin").str();
+                if (std::filesystem::exists(filename)) return filename;
+            }
+
+            return "";
+        }
+
+        template<typename T>
+        bool readValue(std::istream &file, T &value)
+        {
+            file.read(reinterpret_cast<char *>(&value), sizeof(T));
+            return file.good();
+        }
+
+        template<typename T>
+        void writeValue(std::ostream &file, const T &value)
+        {
+            file.write(reinterpret_cast<const char *>(&value), sizeof(T));
+        }
+
+        // Reads the cache file, returning false if it is from a different version or map
+        // Entries with a checksum mismatch are skipped, so they will be recomputed and rewritten
+        bool readFile(std::istream &file)
+        {
+            char fileMagic[4];
+            unsigned int version, width, height, count;
+            file.read(fileMagic, 4);
+            if (!file.good() || std::memcmp(fileMagic, magic, 4) != 0) return false;
+            if (!readValue(file, version) || version != MAP_DATA_CACHE_VERSION) return false;
+            if (!readValue(file, width) || width != (unsigned int)BWAPI::Broodwar->mapWidth()) return false;
+            if (!readValue(file, height) || height != (unsigned int)BWAPI::Broodwar->mapHeight()) return false;
+            if (!readValue(file, count)) return false;
+
+            for (unsigned int i = 0; i < count; i++)
+            {
+                unsigned int keyLength;
+                unsigned long long inputChecksum, dataSize, dataChecksum;
+                if (!readValue(file, keyLength) || keyLength > 1024) return false;
+                std::string key(keyLength, '\0');
+                file.read(key.data(), keyLength);
+                if (!readValue(file, inputChecksum)) return false;
+                if (!readValue(file, dataSize)) return false;
+                if (!readValue(file, dataChecksum)) return false;
+
+                std::vector<unsigned char> data(dataSize);
+                file.read(reinterpret_cast<char *>(data.data()), (std::streamsize)dataSize);
+                if (!file.good()) return false;
+
+                if (checksum(data.data(), data.size()) != dataChecksum)
+                {
+                    Log::Get() << "Map data cache entry " << key << " has an invalid checksum, will recompute";
+                    continue;
+                }
+
+                entries[std::make_pair(key, inputChecksum)] = Entry{std::move(data), false};
+            }
+
+            return true;
+        }
+    }
+
+    void initialize()
+    {
+        entries.clear();
+        added = false;
+
+        auto filename = cacheFilename();
+        if (filename.empty()) return;
+
+        std::ifstream file(filename, std::ifstream::binary);
+        if (!file.good()) return;
+
+        try
+        {
+            if (!readFile(file))
+            {
+                Log::Get() << "Ignoring invalid or outdated map data cache " << filename;
+                entries.clear();
+                return;
+            }
+        }
+        catch (std::exception &ex)
+        {
+            Log::Get() << "Exception caught reading map data cache: " << ex.what();
+            entries.clear();
+            return;
+        }
+
+        Log::Get() << "Loaded " << entries.size() << " entries from map data cache " << filename;
+    }
+
+    void write()
+    {
+        if (!added) return;
+
+        // Entries used this game are always kept; the rest are kept until the size limit is reached
+        size_t sizeLimit = (size_t)MAP_DATA_CACHE_MAX_SIZE_MB * 1024 * 1024;
+        size_t size = 0;
+        std::vector<const std::pair<const std::pair<std::string, unsigned long long>, Entry> *> entriesToWrite;
+        for (const auto &entry : entries)
+        {
+            if (!entry.second.usedThisGame) continue;
+            entriesToWrite.push_back(&entry);
+            size += entry.second.data.size();
+        }
+        for (const auto &entry : entries)
+        {
+            if (entry.second.usedThisGame) continue;
+            if (size + entry.second.data.size() > sizeLimit) continue;
+            entriesToWrite.push_back(&entry);
+            size += entry.second.data.size();
+        }
+
+        std::ofstream file(cacheFilename(true), std::ofstream::binary | std::ofstream::trunc);
+        file.write(magic, 4);
+        writeValue(file, (unsigned int)MAP_DATA_CACHE_VERSION);
+        writeValue(file, (unsigned int)BWAPI::Broodwar->mapWidth());
+        writeValue(file, (unsigned int)BWAPI::Broodwar->mapHeight());
+        writeValue(file, (unsigned int)entriesToWrite.size());
+        for (auto entry : entriesToWrite)
+        {
+            auto &key = entry->first.first;
+            auto &data = entry->second.data;
+            writeValue(file, (unsigned int)key.size());
+            file.write(key.data(), (std::streamsize)key.size());
+            writeValue(file, entry->first.second);
+            writeValue(file, (unsigned long long)data.size());
+            writeValue(file, checksum(data.data(), data.size()));
+            file.write(reinterpret_cast<const char *>(data.data()), (std::streamsize)data.size());
+        }
+
+        file.close();
+        added = false;
+    }
+
+    const std::vector<unsigned char> *get(const std::string &key, unsigned long long inputChecksum)
+    {
+        auto it = entries.find(std::make_pair(key, inputChecksum));
+        if (it == entries.end()) return nullptr;
+
+        it->second.usedThisGame = true;
+        return &it->second.data;
+    }
+
+    void put(const std::string &key, unsigned long long inputChecksum, std::vector<unsigned char> &&data)
+    {
+        entries[std::make_pair(key, inputChecksum)] = Entry{std::move(data), true};
+        added = true;
+    }
+
+    unsigned long long checksum(const void *data, size_t size, unsigned long long previous)
+    {
+        auto bytes = static_cast<const unsigned char *>(data);
+        for (size_t i = 0; i < size; i++)
+        {
+            previous ^= bytes[i];
+            previous *= 1099511628211ULL;
+        }
+        return previous;
+    }
+}
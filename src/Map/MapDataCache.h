@@ -0,0 +1,24 @@
+#pragma once
+
+#include "Common.h"
+
+// Cache of expensive precomputed map data, persisted between games on the same map
+// Entries are keyed by name and by a checksum of the inputs they were computed from, so data computed from different
+// inputs (e.g. a different starting location) is never returned
+namespace MapDataCache
+{
+    // Loads the cache written by a previous game on the current map, if there is one
+    void initialize();
+
+    // Writes the cache if anything was added this game
+    void write();
+
+    // Gets an entry computed from inputs with the given checksum, returning nullptr if there is none
+    const std::vector<unsigned char> *get(const std::string &key, unsigned long long inputChecksum);
+
+    // Adds an entry, to be written at the end of the game
+    void put(const std::string &key, unsigned long long inputChecksum, std::vector<unsigned char> &&data);
+
+    // FNV-1a checksum of the given bytes, which can be chained by passing the previous checksum
+    unsigned long long checksum(const void *data, size_t size, unsigned long long previous = 14695981039346656037ULL);
+}
@@ -1,7 +1,15 @@
 #include "NavigationGrid.h"
 
+#include <algorithm>
+#include <cstring>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
 #include <queue>
+#include <thread>
 #include "Map.h"
+#include "MapDataCache.h"
 
 #if INSTRUMENTATION_ENABLED
 #define NAVIGATION_HEATMAP_ENABLED false
@@ -13,23 +21,115 @@
 #define DEBUG_LOG_UPDATES false
 #endif
 
+// Set to false to repair grids synchronously on the frame thread
+#define NAVIGATION_GRID_BACKGROUND_REPAIR true
+
+// Set to false to always build grids instead of loading them from the map data cache
+#define NAVIGATION_GRID_CACHE true
+
 #define COST_STRAIGHT 32
 #define COST_DIAGONAL 45
 
+#define NEXT_NODE_VALID 8U
+#define NEXT_NODE_DIRECTION_MASK 7U
+
+#define TILE_WALKABLE 1U
+#define TILE_MINERAL_LINE 2U
+#define TILE_ALLOW_DIAGONAL 4U
+
 namespace
 {
     int mapWidth;
     int mapHeight;
-    
-    bool walkableAndNotMineralLine(int x, int y)
+
+    // Index offsets for each direction, where odd directions are diagonals
+    // Direction d from node A leads to the node at A + offset[d]
+    int directionX[8] = {-1, -1, 1, 1, 0, -1, 0, 1};
+    int directionY[8] = {0, 1, 0, 1, -1, -1, 1, -1};
+    int directionIndexOffset[8];
+
+    unsigned long long queueItem(unsigned int cost, int index, bool diagonal)
     {
-        return Map::isWalkable(x, y) && !Map::isInOwnMineralLine(x, y);
+        return ((unsigned long long)cost << 33U) | ((unsigned long long)index << 1U) | (diagonal ? 1U : 0U);
     }
 
-    bool allowDiagonalConnectionThrough(int x, int y)
+    // Copy of the map data read by grid repairs, so repairs can run on the background thread while the map changes
+    // Each snapshot is immutable; when tiles change, the next repair gets a new copy with the changed tiles updated
+    std::shared_ptr<const std::vector<unsigned char>> tileFlags;
+    std::set<BWAPI::TilePosition> staleTiles;
+
+    // The snapshot taken at startup, which grids built before anything changes are cached against
+    std::shared_ptr<const std::vector<unsigned char>> initialTileFlags;
+    unsigned long long initialTileFlagsChecksum;
+
+    unsigned char computeTileFlags(int x, int y)
     {
-        return Map::isWalkable(x, y) || Map::mapSpecificOverride()->allowDiagonalPathingThrough(x, y);
+        unsigned char flags = 0;
+        if (Map::isWalkable(x, y)) flags |= TILE_WALKABLE;
+        if (Map::isInOwnMineralLine(x, y)) flags |= TILE_MINERAL_LINE;
+        if (Map::mapSpecificOverride()->allowDiagonalPathingThrough(x, y)) flags |= TILE_ALLOW_DIAGONAL;
+        return flags;
     }
+
+    std::shared_ptr<const std::vector<unsigned char>> currentTileFlags()
+    {
+        if (staleTiles.empty()) return tileFlags;
+
+        auto updated = std::make_shared<std::vector<unsigned char>>(*tileFlags);
+        for (const auto &tile : staleTiles)
+        {
+            (*updated)[tile.x + tile.y * mapWidth] = computeTileFlags(tile.x, tile.y);
+        }
+        staleTiles.clear();
+
+        tileFlags = std::move(updated);
+        return tileFlags;
+    }
+
+#if NAVIGATION_GRID_BACKGROUND_REPAIR
+    // Runs grid builds and repairs on a pool of background threads, in the order they are queued
+    // A grid only ever has one build or repair running, so jobs for different grids are independent
+    // Allocated once and never destroyed, so the threads can never outlive what they wait on at process exit
+    struct RepairThreads
+    {
+        std::mutex mutex;
+        std::condition_variable jobAvailable;
+        std::deque<std::function<void()>> jobs;
+
+        explicit RepairThreads(unsigned int count)
+        {
+            for (unsigned int i = 0; i < count; i++)
+            {
+                std::thread([this]()
+                            {
+                                while (true)
+                                {
+                                    std::function<void()> job;
+                                    {
+                                        std::unique_lock<std::mutex> lock(mutex);
+                                        jobAvailable.wait(lock, [this]() { return !jobs.empty(); });
+                                        job = std::move(jobs.front());
+                                        jobs.pop_front();
+                                    }
+
+                                    job();
+                                }
+                            }).detach();
+            }
+        }
+
+        void enqueue(std::function<void()> &&job)
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                jobs.push_back(std::move(job));
+            }
+            jobAvailable.notify_one();
+        }
+    };
+
+    RepairThreads *repairThreads = nullptr;
+#endif
 }
 
 namespace NavigationGridGlobals
@@ -38,29 +138,208 @@ namespace NavigationGridGlobals
     {
         mapWidth = BWAPI::Broodwar->mapWidth();
         mapHeight = BWAPI::Broodwar->mapHeight();
+
+        for (int d = 0; d < 8; d++)
+        {
+            directionIndexOffset[d] = directionX[d] + directionY[d] * mapWidth;
+        }
+
+        auto flags = std::make_shared<std::vector<unsigned char>>(mapWidth * mapHeight);
+        for (int y = 0; y < mapHeight; y++)
+        {
+            for (int x = 0; x < mapWidth; x++)
+            {
+                (*flags)[x + y * mapWidth] = computeTileFlags(x, y);
+            }
+        }
+        tileFlags = std::move(flags);
+        staleTiles.clear();
+
+        initialTileFlags = tileFlags;
+        initialTileFlagsChecksum = MapDataCache::checksum(initialTileFlags->data(), initialTileFlags->size());
+
+#if NAVIGATION_GRID_BACKGROUND_REPAIR
+        // Leave a core for the frame thread
+        if (!repairThreads)
+        {
+            auto cores = std::thread::hardware_concurrency();
+            repairThreads = new RepairThreads(cores > 2 ? std::min(cores - 1, 8U) : 1);
+        }
+#endif
+    }
+
+    size_t gridMemoryUsage()
+    {
+        return mapWidth * mapHeight * (sizeof(unsigned short) + sizeof(unsigned char) * 2);
+    }
+
+    void tilesChanged(BWAPI::TilePosition tile, BWAPI::TilePosition size)
+    {
+        for (int x = tile.x; x < tile.x + size.x; x++)
+        {
+            for (int y = tile.y; y < tile.y + size.y; y++)
+            {
+                staleTiles.emplace(x, y);
+            }
+        }
+    }
+
+    void tilesChanged(const std::set<BWAPI::TilePosition> &tiles)
+    {
+        staleTiles.insert(tiles.begin(), tiles.end());
     }
 }
 
-NavigationGrid::NavigationGrid(BWAPI::TilePosition goal, BWAPI::TilePosition goalSize) : goal(goal)
+// The state of a grid being brought up-to-date with a set of blocking changes
+// Everything a repair reads or writes is owned by it, so it can run on the background thread while the frame thread reads the grid
+struct NavigationGrid::Repair
 {
-    // Create each grid cell with its x,y coordinates
-    grid.reserve(mapWidth * mapHeight);
-    for (int y = 0; y < mapHeight; y++)
+    BWAPI::TilePosition goal;
+    BWAPI::TilePosition goalSize;
+
+    // Whether to build the grid from scratch instead of applying blocking changes to the current nodes
+    bool fromScratch;
+
+    // Builds from the initial map snapshot are cached under this key; the nodes are already set if it was loaded from the cache
+    std::string cacheKey;
+    bool loadedFromCache;
+
+    std::shared_ptr<const std::vector<unsigned char>> tileFlags;
+
+    // Blocking changes to apply, in addition to the nodes already queued
+    std::vector<std::pair<BWAPI::TilePosition, BWAPI::TilePosition>> blockingObjects;
+    std::set<BWAPI::TilePosition> blockingTiles;
+    std::set<BWAPI::TilePosition> unblockedTiles;
+
+    std::vector<unsigned short> costs;
+    std::vector<unsigned char> nextDirections;
+    std::vector<unsigned char> prevNodes;
+
+    // Nodes queued before the search; these seed the bucket queue in cost order
+    std::vector<QueueItem> queuedNodes;
+
+    // Bucket queue used while searching, holding node index and diagonal flag in the bucket for cost % BUCKET_COUNT
+    // Since every edge costs at most COST_DIAGONAL, all costs in the queue fit in one window of buckets
+    std::array<std::vector<int>, BUCKET_COUNT> buckets;
+
+    Repair(BWAPI::TilePosition goal, BWAPI::TilePosition goalSize) : goal(goal), goalSize(goalSize), fromScratch(false), loadedFromCache(false) {}
+
+    [[nodiscard]] bool isWalkable(int x, int y) const
     {
-        for (int x = 0; x < mapWidth; x++)
+        return (*tileFlags)[x + y * mapWidth] & TILE_WALKABLE;
+    }
+
+    [[nodiscard]] bool walkableAndNotMineralLine(int x, int y) const
+    {
+        return isWalkable(x, y) && !((*tileFlags)[x + y * mapWidth] & TILE_MINERAL_LINE);
+    }
+
+    [[nodiscard]] bool allowDiagonalConnectionThrough(int x, int y) const
+    {
+        return isWalkable(x, y) || ((*tileFlags)[x + y * mapWidth] & TILE_ALLOW_DIAGONAL);
+    }
+
+    [[nodiscard]] std::string describe(int index) const
+    {
+        std::ostringstream os;
+        os << "(" << (index % mapWidth) << "," << (index / mapWidth) << ":" << costs[index] << ")";
+        if (nextDirections[index] & NEXT_NODE_VALID)
+        {
+            auto next = index - directionIndexOffset[nextDirections[index] & NEXT_NODE_DIRECTION_MASK];
+            os << "->(" << (next % mapWidth) << "," << (next / mapWidth) << ":" << costs[next] << ")";
+        }
+        return os.str();
+    }
+
+    void queueNode(int index)
+    {
+        queuedNodes.push_back(queueItem(costs[index] + COST_STRAIGHT, index, false));
+        queuedNodes.push_back(queueItem(costs[index] + COST_DIAGONAL, index, true));
+    }
+
+    void run()
+    {
+        if (loadedFromCache)
+        {
+            // Nothing to do
+        }
+        else if (fromScratch)
+        {
+            initializeNodes();
+            search();
+        }
+        else
         {
-            grid.emplace_back(x, y);
+            applyUnblockedTiles();
+            applyBlockingObjects();
+            applyBlockingTiles();
+            search();
         }
+
+#if VALIDATE_GRIDS_AFTER_EACH_UPDATE
+        validate();
+#endif
     }
 
+    bool loadFromCache();
+    void storeInCache() const;
+    void initializeNodes();
+    void applyUnblockedTiles();
+    void applyBlockingObjects();
+    void applyBlockingTiles();
+    void search();
+    void validate() const;
+};
+
+bool NavigationGrid::Repair::loadFromCache()
+{
+    auto data = MapDataCache::get(cacheKey, initialTileFlagsChecksum);
+    auto size = (size_t)(mapWidth * mapHeight);
+    if (!data || data->size() != size * (sizeof(unsigned short) + 2)) return false;
+
+    costs.resize(size);
+    nextDirections.resize(size);
+    prevNodes.resize(size);
+
+    auto src = data->data();
+    std::memcpy(costs.data(), src, size * sizeof(unsigned short));
+    src += size * sizeof(unsigned short);
+    std::memcpy(nextDirections.data(), src, size);
+    src += size;
+    std::memcpy(prevNodes.data(), src, size);
+
+    loadedFromCache = true;
+    return true;
+}
+
+void NavigationGrid::Repair::storeInCache() const
+{
+    auto size = (size_t)(mapWidth * mapHeight);
+    std::vector<unsigned char> data(size * (sizeof(unsigned short) + 2));
+
+    auto dest = data.data();
+    std::memcpy(dest, costs.data(), size * sizeof(unsigned short));
+    dest += size * sizeof(unsigned short);
+    std::memcpy(dest, nextDirections.data(), size);
+    dest += size;
+    std::memcpy(dest, prevNodes.data(), size);
+
+    MapDataCache::put(cacheKey, initialTileFlagsChecksum, std::move(data));
+}
+
+void NavigationGrid::Repair::initializeNodes()
+{
+    costs.assign(mapWidth * mapHeight, USHRT_MAX);
+    nextDirections.assign(mapWidth * mapHeight, 0);
+    prevNodes.assign(mapWidth * mapHeight, 0);
+
     auto pushInitialTile = [&](BWAPI::TilePosition tile)
     {
         if (!tile.isValid()) return;
 
-        auto &node = (*this)[tile];
-        node.cost = 0;
-        nodeQueue.emplace(COST_STRAIGHT, &node, false);
-        nodeQueue.emplace(COST_DIAGONAL, &node, true);
+        auto index = tile.x + tile.y * mapWidth;
+        costs[index] = 0;
+        queueNode(index);
     };
 
     if (goalSize.isValid())
@@ -80,461 +359,700 @@ NavigationGrid::NavigationGrid(BWAPI::TilePosition goal, BWAPI::TilePosition goa
     {
         pushInitialTile(goal);
     }
-
-    update();
 }
 
-NavigationGrid::GridNode &NavigationGrid::operator[](BWAPI::Position pos)
+void NavigationGrid::Repair::applyUnblockedTiles()
 {
-    return grid[(pos.x >> 5U) + (pos.y >> 5U) * mapWidth];
-}
+    if (unblockedTiles.empty()) return;
 
-const NavigationGrid::GridNode &NavigationGrid::operator[](BWAPI::Position pos) const
-{
-    return grid[(pos.x >> 5U) + (pos.y >> 5U) * mapWidth];
-}
+    // Reset the cost of all nodes corresponding to the blocking tiles being removed
+    // While doing this, gather tiles that potentially border these blocking tiles
+    // Finally add the valid border tiles to the update queue
 
-NavigationGrid::GridNode &NavigationGrid::operator[](BWAPI::WalkPosition pos)
-{
-    return grid[(pos.x >> 2U) + (pos.y >> 2U) * mapWidth];
-}
+    std::set<int> bordering;
+    auto addBordering = [&](unsigned short x, unsigned short y)
+    {
+        if (x >= mapWidth || y >= mapHeight)
+        {
+            return;
+        }
 
-const NavigationGrid::GridNode &NavigationGrid::operator[](BWAPI::WalkPosition pos) const
-{
-    return grid[(pos.x >> 2U) + (pos.y >> 2U) * mapWidth];
+        bordering.insert(x + y * mapWidth);
+    };
+
+    auto visit = [&](unsigned short x, unsigned short y)
+    {
+        auto index = x + y * mapWidth;
+
+        costs[index] = USHRT_MAX;
+        if (nextDirections[index] & NEXT_NODE_VALID)
+        {
+            auto direction = nextDirections[index] & NEXT_NODE_DIRECTION_MASK;
+            prevNodes[index - directionIndexOffset[direction]] &= ~(1U << direction);
+            nextDirections[index] = 0;
+        }
+
+        addBordering(x + 1, y);
+        addBordering(x - 1, y);
+        addBordering(x, y + 1);
+        addBordering(x, y - 1);
+        addBordering(x - 1, y - 1);
+        addBordering(x + 1, y - 1);
+        addBordering(x - 1, y + 1);
+        addBordering(x + 1, y + 1);
+    };
+    for (const auto &tile : unblockedTiles)
+    {
+        visit(tile.x, tile.y);
+    }
+
+    for (auto index : bordering)
+    {
+        if (nextDirections[index] & NEXT_NODE_VALID)
+        {
+#if DEBUG_LOG_UPDATES
+            Log::Debug() << "Grid-" << goal << ": removeBlocking, enqueued " << describe(index);
+#endif
+
+            queueNode(index);
+        }
+    }
 }
 
-NavigationGrid::GridNode &NavigationGrid::operator[](BWAPI::TilePosition pos)
+void NavigationGrid::Repair::applyBlockingObjects()
 {
-    return grid[pos.x + pos.y * mapWidth];
+    for (const auto &[tile, size] : blockingObjects)
+    {
+        for (int x = tile.x; x < tile.x + size.x; x++)
+        {
+            for (int y = tile.y; y < tile.y + size.y; y++)
+            {
+                blockingTiles.insert(BWAPI::TilePosition(x, y));
+            }
+        }
+
+        // Add tiles that have diagonal connections through a corner of the object
+        auto addCornerTile = [&](int toX, int toY, unsigned int direction)
+        {
+            if (toX < 0) return;
+            if (toX >= mapWidth) return;
+            if (toY < 0) return;
+            if (toY >= mapHeight) return;
+
+            if (prevNodes[toX + toY * mapWidth] & (1U << direction))
+            {
+#if DEBUG_LOG_UPDATES
+                Log::Debug() << "Grid-" << goal << ": Added corner tile " << BWAPI::TilePosition(toX, toY) << " for direction " << direction;
+#endif
+
+                blockingTiles.insert(BWAPI::TilePosition(toX, toY));
+            }
+        };
+        addCornerTile(tile.x, tile.y - 1, 1); // up-right, top-left corner
+        addCornerTile(tile.x + size.x, tile.y + size.y - 1, 1); // up-right, bottom-right corner
+        addCornerTile(tile.x + size.x - 1, tile.y - 1, 3); // up-left, top-right corner
+        addCornerTile(tile.x - 1, tile.y + size.y - 1, 3); // up-left, bottom-left corner
+        addCornerTile(tile.x + size.x, tile.y, 5); // down-right, top-right corner
+        addCornerTile(tile.x, tile.y + size.y, 5); // down-right, bottom-left corner
+        addCornerTile(tile.x - 1, tile.y, 7); // down-left, top-left corner
+        addCornerTile(tile.x + size.x - 1, tile.y + size.y, 7); // down-left, bottom-right corner
+    }
 }
 
-const NavigationGrid::GridNode &NavigationGrid::operator[](BWAPI::TilePosition pos) const
+void NavigationGrid::Repair::applyBlockingTiles()
 {
-    return grid[pos.x + pos.y * mapWidth];
+    if (blockingTiles.empty()) return;
+
+#if DEBUG_LOG_UPDATES
+    Log::Debug() << "Grid-" << goal << ": Updating blocking tiles";
+#endif
+
+    // First, invalidate every path that goes through the tiles
+    // Then push all still-valid tiles bordering an invalidated tile to the update queue
+    // When the grid is updated, all of the invalidated tiles will receive a new path from these bordering tiles
+
+    std::queue<int> queue;
+    for (const auto &tile : blockingTiles)
+    {
+        queue.push(tile.x + tile.y * mapWidth);
+    }
+
+    std::set<int> bordering;
+    auto addBordering = [&](unsigned short x, unsigned short y)
+    {
+        if (x >= mapWidth || y >= mapHeight)
+        {
+            return;
+        }
+
+        bordering.insert(x + y * mapWidth);
+    };
+
+    auto visit = [&](int current, unsigned char direction)
+    {
+        auto index = current + directionIndexOffset[direction];
+        unsigned short x = index % mapWidth;
+        unsigned short y = index / mapWidth;
+
+        costs[index] = USHRT_MAX;
+        nextDirections[index] = 0;
+        if (prevNodes[index]) queue.push(index);
+
+        addBordering(x + 1, y);
+        addBordering(x - 1, y);
+        addBordering(x, y + 1);
+        addBordering(x, y - 1);
+        addBordering(x - 1, y - 1);
+        addBordering(x + 1, y - 1);
+        addBordering(x - 1, y + 1);
+        addBordering(x + 1, y + 1);
+    };
+
+    while (!queue.empty())
+    {
+        int current = queue.front();
+        queue.pop();
+
+        auto prev = prevNodes[current];
+        for (unsigned char direction : {1, 3, 5, 7, 0, 2, 4, 6})
+        {
+            if (prev & (1U << direction)) visit(current, direction);
+        }
+
+        prevNodes[current] = 0;
+    }
+
+    // Push all valid bordering tiles to the update queue
+    for (auto index : bordering)
+    {
+        if (nextDirections[index] & NEXT_NODE_VALID)
+        {
+#if DEBUG_LOG_UPDATES
+            Log::Debug() << "Grid-" << goal << ": updateBlockingTiles, enqueued " << describe(index);
+#endif
+
+            queueNode(index);
+        }
+    }
 }
 
-void NavigationGrid::update()
+void NavigationGrid::Repair::search()
 {
-    updateBlockingTiles();
-    if (nodeQueue.empty()) return;
+    if (queuedNodes.empty()) return;
 
 #if DEBUG_LOG_UPDATES
     Log::Debug() << "Grid-" << goal << ": Updating grid";
 #endif
 
-#if OUTPUT_GRID_TIMING
-    auto start = std::chrono::high_resolution_clock::now();
-#endif
-
-    auto visit = [&](NavigationGrid::GridNode *current, unsigned short x, unsigned short y, unsigned char direction)
+    int bucketedNodes = 0;
+    auto visit = [&](int current, int currentX, int currentY, unsigned char direction)
     {
         // Check validity of the tile
-        // Since we are using unsigned shorts, we don't need to worry about <0 (they will wrap to be larger than the map)
-        if (x >= mapWidth || y >= mapHeight)
+        // Casting to unsigned means we don't need to worry about <0 (they will wrap to be larger than the map)
+        auto x = (unsigned int)(currentX + directionX[direction]);
+        auto y = (unsigned int)(currentY + directionY[direction]);
+        if (x >= (unsigned int)mapWidth || y >= (unsigned int)mapHeight)
         {
             return;
         }
 
-        auto &node = grid[x + y * mapWidth];
+        auto index = current + directionIndexOffset[direction];
 
         // Compute the cost of this node
-        auto cost = current->cost + (direction % 2 == 1 ? COST_DIAGONAL : COST_STRAIGHT);
-        //cost -= std::max((unsigned short)4U, Map::unwalkableProximity(x, y));
+        auto cost = costs[current] + (direction % 2 == 1 ? COST_DIAGONAL : COST_STRAIGHT);
 
         // If the node already has a lower cost, we don't need to consider it
-        if (node.cost <= cost) return;
+        if (costs[index] <= cost) return;
 
         // Don't allow a diagonal connection from a walkable tile through a blocked tile
-        if (direction % 2 == 1 && Map::isWalkable(x, y) &&
-            (!allowDiagonalConnectionThrough(x, current->y) || !allowDiagonalConnectionThrough(current->x, y)))
+        if (direction % 2 == 1 && isWalkable(x, y) &&
+            (!allowDiagonalConnectionThrough(x, currentY) || !allowDiagonalConnectionThrough(currentX, y)))
         {
             return;
         }
 
         // Make the connection if it isn't already done
-        node.cost = cost;
-        if (node.nextNode != current)
+        costs[index] = cost;
+        auto next = nextDirections[index];
+        if (next != (NEXT_NODE_VALID | direction))
         {
             // Remove the reverse connection if the node was previously connected to another one
-            if (node.nextNode)
+            if (next & NEXT_NODE_VALID)
             {
-                if (node.nextNode->x < node.x)
-                {
-                    if (node.nextNode->y < node.y)
-                    {
-                        node.nextNode->prevNodes &= ~(1U << 3U);
-                    }
-                    else if (node.nextNode->y > node.y)
-                    {
-                        node.nextNode->prevNodes &= ~(1U << 7U);
-                    }
-                    else
-                    {
-                        node.nextNode->prevNodes &= ~(1U << 2U);
-                    }
-                }
-                else if (node.nextNode->x > node.x)
-                {
-                    if (node.nextNode->y < node.y)
-                    {
-                        node.nextNode->prevNodes &= ~(1U << 1U);
-                    }
-                    else if (node.nextNode->y > node.y)
-                    {
-                        node.nextNode->prevNodes &= ~(1U << 5U);
-                    }
-                    else
-                    {
-                        node.nextNode->prevNodes &= ~(1U << 0U);
-                    }
-                }
-                else
-                {
-                    if (node.nextNode->y < node.y)
-                    {
-                        node.nextNode->prevNodes &= ~(1U << 6U);
-                    }
-                    else
-                    {
-                        node.nextNode->prevNodes &= ~(1U << 4U);
-                    }
-                }
+                auto previousDirection = next & NEXT_NODE_DIRECTION_MASK;
+                prevNodes[index - directionIndexOffset[previousDirection]] &= ~(1U << previousDirection);
             }
 
             // Create the connection
-            node.nextNode = current;
-            current->prevNodes |= 1U << direction;
+            nextDirections[index] = NEXT_NODE_VALID | direction;
+            prevNodes[current] |= 1U << direction;
         }
 
         // Queue the node if it is walkable
         if (walkableAndNotMineralLine(x, y))
         {
 #if DEBUG_LOG_UPDATES
-            Log::Debug() << "Grid-" << goal << ": Queueing " << node;
+            Log::Debug() << "Grid-" << goal << ": Queueing " << describe(index);
 #endif
 
-            nodeQueue.emplace(node.cost + COST_STRAIGHT, &node, false);
-            nodeQueue.emplace(node.cost + COST_DIAGONAL, &node, true);
+            buckets[(cost + COST_STRAIGHT) % BUCKET_COUNT].push_back(index << 1);
+            buckets[(cost + COST_DIAGONAL) % BUCKET_COUNT].push_back((index << 1) | 1);
+            bucketedNodes += 2;
         }
     };
 
-    while (!nodeQueue.empty())
+    auto process = [&](unsigned int cost, int item)
     {
-        std::tuple<unsigned short, GridNode *, bool> current = nodeQueue.top();
-        nodeQueue.pop();
+        auto index = item >> 1;
+        bool diagonal = item & 1;
 
-        auto node = std::get<1>(current);
+        // Skip items for nodes that have had their cost changed since they were queued
+        // The node was queued again with its new cost and has already been processed from that item
+        if (costs[index] + (diagonal ? COST_DIAGONAL : COST_STRAIGHT) != (int)cost) return;
 
-        if (!walkableAndNotMineralLine(node->x, node->y) || node->cost == USHRT_MAX) continue;
+        int x = index % mapWidth;
+        int y = index / mapWidth;
+
+        if (!walkableAndNotMineralLine(x, y)) return;
 
 #if DEBUG_LOG_UPDATES
-        Log::Debug() << "Grid-" << goal << ": Processing " << *node << "; diag=" << std::get<2>(current);
+        Log::Debug() << "Grid-" << goal << ": Processing " << describe(index) << "; diag=" << diagonal;
 #endif
 
-        // Boolean controls whether we are considering diagonal edges or straight edges
-        if (std::get<2>(current))
+        // The diagonal flag controls whether we are considering diagonal edges or straight edges
+        if (diagonal)
         {
             // Diagonals
-            visit(node, node->x - 1, node->y + 1, 1);
-            visit(node, node->x + 1, node->y + 1, 3);
-            visit(node, node->x - 1, node->y - 1, 5);
-            visit(node, node->x + 1, node->y - 1, 7);
+            visit(index, x, y, 1);
+            visit(index, x, y, 3);
+            visit(index, x, y, 5);
+            visit(index, x, y, 7);
         }
         else
         {
             // Straight edges
-            visit(node, node->x - 1, node->y, 0);
-            visit(node, node->x + 1, node->y, 2);
-            visit(node, node->x, node->y - 1, 4);
-            visit(node, node->x, node->y + 1, 6);
+            visit(index, x, y, 0);
+            visit(index, x, y, 2);
+            visit(index, x, y, 4);
+            visit(index, x, y, 6);
         }
-    }
+    };
 
-#if OUTPUT_GRID_TIMING
-    auto now = std::chrono::high_resolution_clock::now();
-    Log::Get() << "Update navigation grid " << goal << ": " << std::chrono::duration_cast<std::chrono::microseconds>(now - start).count() << "us";
-#endif
+    // Dial's algorithm: since edge costs are small integers, we can process nodes in cost order by scanning buckets of equal cost
+    // instead of using a heap. The nodes queued before the update may have any cost, so they are sorted and merged in as the scan
+    // reaches their cost, and the scan jumps ahead to the next queued node whenever the buckets are empty.
+    std::sort(queuedNodes.begin(), queuedNodes.end());
+    size_t nextQueuedNode = 0;
+    auto queuedCost = [&]()
+    {
+        return (unsigned int)(queuedNodes[nextQueuedNode] >> 33U);
+    };
 
-#if NAVIGATION_HEATMAP_ENABLED
-    dumpHeatmap();
-#endif
+    auto currentCost = queuedCost();
+    while (true)
+    {
+        while (nextQueuedNode < queuedNodes.size() && queuedCost() == currentCost)
+        {
+            process(currentCost, (int)(queuedNodes[nextQueuedNode] & 0x1FFFFFFFFULL));
+            nextQueuedNode++;
+        }
 
-#if VALIDATE_GRIDS_AFTER_EACH_UPDATE
+        // Processing a node only adds to buckets with a higher cost, so the current bucket cannot grow while we drain it
+        auto &bucket = buckets[currentCost % BUCKET_COUNT];
+        bucketedNodes -= (int)bucket.size();
+        for (auto item : bucket)
+        {
+            process(currentCost, item);
+        }
+        bucket.clear();
+
+        if (bucketedNodes > 0)
+        {
+            currentCost++;
+        }
+        else if (nextQueuedNode < queuedNodes.size())
+        {
+            currentCost = queuedCost();
+        }
+        else
+        {
+            break;
+        }
+    }
+
+    queuedNodes.clear();
+}
+
+void NavigationGrid::Repair::validate() const
+{
     for (int y = 0; y < mapHeight; y++)
     {
         for (int x = 0; x < mapWidth; x++)
         {
-            auto &node = grid[x + y * mapWidth];
+            auto index = x + y * mapWidth;
+            int next = (nextDirections[index] & NEXT_NODE_VALID)
+                       ? index - directionIndexOffset[nextDirections[index] & NEXT_NODE_DIRECTION_MASK]
+                       : -1;
 
-            if (node.cost > 0 && node.cost < USHRT_MAX && !node.nextNode)
+            if (costs[index] > 0 && costs[index] < USHRT_MAX && next == -1)
             {
-                Log::Get() << "ERROR: Grid-" << goal << ": Node with no next node " << node;
+                Log::Get() << "ERROR: Grid-" << goal << ": Node with no next node " << describe(index);
                 return;
             }
 
-            if (node.cost == 0 && node.nextNode)
+            if (costs[index] == 0 && next != -1)
             {
-                Log::Get() << "ERROR: Grid-" << goal << ": Goal node with next node " << node;
+                Log::Get() << "ERROR: Grid-" << goal << ": Goal node with next node " << describe(index);
                 return;
             }
 
-            if (node.nextNode)
+            if (next != -1)
             {
-                int costDiff = node.cost - node.nextNode->cost;
+                int costDiff = costs[index] - costs[next];
                 if (costDiff <= 0)
                 {
-                    Log::Get() << "ERROR: Grid-" << goal << ": Non-decreasing cost from " << node << " to " << (*node.nextNode) << ": " << costDiff;
+                    Log::Get() << "ERROR: Grid-" << goal << ": Non-decreasing cost from " << describe(index) << " to " << describe(next)
+                               << ": " << costDiff;
                 }
                 if (costDiff != COST_STRAIGHT && costDiff != COST_DIAGONAL)
                 {
-                    Log::Get() << "ERROR: Grid-" << goal << ": Invalid cost from " << node << " to " << (*node.nextNode) << ": " << costDiff;
+                    Log::Get() << "ERROR: Grid-" << goal << ": Invalid cost from " << describe(index) << " to " << describe(next)
+                               << ": " << costDiff;
                     return;
                 }
-                if (costDiff == COST_DIAGONAL && Map::isWalkable(x, y) &&
-                    (!allowDiagonalConnectionThrough(node.nextNode->x, y) || !allowDiagonalConnectionThrough(x, node.nextNode->y)))
+                if (costDiff == COST_DIAGONAL && isWalkable(x, y) &&
+                    (!allowDiagonalConnectionThrough(next % mapWidth, y) || !allowDiagonalConnectionThrough(x, next / mapWidth)))
                 {
-                    Log::Get() << "ERROR: Grid-" << goal << ": Diagonal path through blocked tile from " << node << " to " << (*node.nextNode);
+                    Log::Get() << "ERROR: Grid-" << goal << ": Diagonal path through blocked tile from " << describe(index) << " to "
+                               << describe(next);
+                    return;
+                }
+                if (!(prevNodes[next] & (1U << (nextDirections[index] & NEXT_NODE_DIRECTION_MASK))))
+                {
+                    Log::Get() << "ERROR: Grid-" << goal << ": Missing reverse connection from " << describe(next) << " to "
+                               << describe(index);
                     return;
                 }
             }
 
-            auto current = node.nextNode;
+            auto current = next;
             int i = 0;
-            while (current != nullptr && i < 5)
+            while (current != -1 && i < 5)
             {
-                if (current == &node)
+                if (current == index)
                 {
-                    Log::Get() << "ERROR: Grid-" << goal << ": Loop between " << node << " and " << *current;
+                    Log::Get() << "ERROR: Grid-" << goal << ": Loop between " << describe(index) << " and " << describe(current);
                     return;
                 }
 
-                if (!Map::isWalkable(current->x, current->y))
+                if (!isWalkable(current % mapWidth, current / mapWidth))
                 {
-                    Log::Get() << "ERROR: Grid-" << goal << ": Path from " << node << " goes through unwalkable tile " << *current;
+                    Log::Get() << "ERROR: Grid-" << goal << ": Path from " << describe(index) << " goes through unwalkable tile "
+                               << describe(current);
                     return;
                 }
 
-                current = current->nextNode;
+                current = (nextDirections[current] & NEXT_NODE_VALID)
+                          ? current - directionIndexOffset[nextDirections[current] & NEXT_NODE_DIRECTION_MASK]
+                          : -1;
                 i++;
             }
         }
     }
-#endif
 }
 
-void NavigationGrid::addBlockingObject(BWAPI::TilePosition tile, BWAPI::TilePosition size)
+int NavigationGrid::GridNode::x() const
 {
-#if DEBUG_LOG_UPDATES
-    Log::Debug() << "Grid-" << goal << ": addBlockingObject(" << tile << "," << size << ")";
-#endif
+    return index % mapWidth;
+}
 
-    for (int x = tile.x; x < tile.x + size.x; x++)
-    {
-        for (int y = tile.y; y < tile.y + size.y; y++)
-        {
-            pendingBlockingTiles.insert(BWAPI::TilePosition(x, y));
-        }
-    }
+int NavigationGrid::GridNode::y() const
+{
+    return index / mapWidth;
+}
 
-    // Add tiles that have diagonal connections through a corner of the object
-    auto addCornerTile = [&](int toX, int toY, unsigned int direction)
-    {
-        if (toX < 0) return;
-        if (toX >= mapWidth) return;
-        if (toY < 0) return;
-        if (toY >= mapHeight) return;
+NavigationGrid::GridNode NavigationGrid::GridNode::nextNode() const
+{
+    auto next = grid->nextIndex(index);
+    if (next == -1) return {};
+    return {grid, next};
+}
 
-        auto &node = grid[toX + toY * mapWidth];
-        if (node.prevNodes & (1U << direction))
-        {
-#if DEBUG_LOG_UPDATES
-            Log::Debug() << "Grid-" << goal << ": Added corner tile " << BWAPI::TilePosition(toX, toY) << " for direction " << direction;
-#endif
+NavigationGrid::NavigationGrid(BWAPI::TilePosition goal, BWAPI::TilePosition goalSize)
+        : goal(goal)
+        , generation(0)
+        , lastUsedFrame(-1)
+        , loadedFromCache(false)
+        , _goalSize(goalSize)
+        , runningRepairFinished(false) {}
 
-            pendingBlockingTiles.insert(BWAPI::TilePosition(toX, toY));
-        }
-    };
-    addCornerTile(tile.x, tile.y - 1, 1); // up-right, top-left corner
-    addCornerTile(tile.x + size.x, tile.y + size.y - 1, 1); // up-right, bottom-right corner
-    addCornerTile(tile.x + size.x - 1, tile.y - 1, 3); // up-left, top-right corner
-    addCornerTile(tile.x - 1, tile.y + size.y - 1, 3); // up-left, bottom-left corner
-    addCornerTile(tile.x + size.x, tile.y, 5); // down-right, top-right corner
-    addCornerTile(tile.x, tile.y + size.y, 5); // down-right, bottom-left corner
-    addCornerTile(tile.x - 1, tile.y, 7); // down-left, top-left corner
-    addCornerTile(tile.x + size.x - 1, tile.y + size.y, 7); // down-left, bottom-right corner
+NavigationGrid::~NavigationGrid()
+{
+    // The background thread may still be writing to the running repair
+    waitForRunningRepair();
 }
 
-void NavigationGrid::addBlockingTiles(const std::set<BWAPI::TilePosition> &tiles)
+int NavigationGrid::nextIndex(int index) const
 {
-    pendingBlockingTiles.insert(tiles.begin(), tiles.end());
+    auto next = nextDirections[index];
+    if (!(next & NEXT_NODE_VALID)) return -1;
+    return index - directionIndexOffset[next & NEXT_NODE_DIRECTION_MASK];
 }
 
-void NavigationGrid::removeBlockingObject(BWAPI::TilePosition tile, BWAPI::TilePosition size)
+size_t NavigationGrid::memoryUsage() const
 {
-#if DEBUG_LOG_UPDATES
-    Log::Debug() << "Grid-" << goal << ": removeBlockingObject(" << tile << "," << size << ")";
-#endif
+    // A running repair holds its own copy of the nodes
+    auto nodeMemory = costs.capacity() * sizeof(unsigned short) + nextDirections.capacity() + prevNodes.capacity();
+    return runningRepair ? nodeMemory * 2 : nodeMemory;
+}
 
-    std::set<BWAPI::TilePosition> tiles;
-    for (int x = tile.x; x < tile.x + size.x; x++)
-    {
-        for (int y = tile.y; y < tile.y + size.y; y++)
-        {
-            tiles.insert(BWAPI::TilePosition(x, y));
-        }
-    }
+void NavigationGrid::release()
+{
+    waitForRunningRepair();
+    runningRepair.reset();
+    pendingRepair.reset();
 
-    removeBlockingTiles(tiles);
+    std::vector<unsigned short>().swap(costs);
+    std::vector<unsigned char>().swap(nextDirections);
+    std::vector<unsigned char>().swap(prevNodes);
 }
 
-void NavigationGrid::removeBlockingTiles(const std::set<BWAPI::TilePosition> &tiles)
+NavigationGrid::Repair &NavigationGrid::pending()
 {
-    // Reset the cost of all nodes corresponding to the blocking tiles being removed
-    // While doing this, gather tiles that potentially border these blocking tiles
-    // Finally add the valid border tiles to the update queue
+    if (!pendingRepair) pendingRepair = std::make_unique<Repair>(goal, _goalSize);
+    return *pendingRepair;
+}
 
-    std::set<GridNode *> bordering;
-    auto addBordering = [&](unsigned short x, unsigned short y)
-    {
-        if (x >= mapWidth || y >= mapHeight)
-        {
-            return;
-        }
+void NavigationGrid::prepareRepair(Repair &repair)
+{
+    repair.tileFlags = currentTileFlags();
+}
 
-        bordering.insert(&grid[x + y * mapWidth]);
-    };
+void NavigationGrid::applyRepair(Repair &repair)
+{
+    if (!repair.cacheKey.empty() && !repair.loadedFromCache) repair.storeInCache();
+    loadedFromCache = repair.loadedFromCache;
 
-    auto visit = [&](unsigned short x, unsigned short y)
-    {
-        auto &node = grid[x + y * mapWidth];
+    costs.swap(repair.costs);
+    nextDirections.swap(repair.nextDirections);
+    prevNodes.swap(repair.prevNodes);
 
-        node.cost = USHRT_MAX;
-        node.nextNode = nullptr;
+#if NAVIGATION_HEATMAP_ENABLED
+    dumpHeatmap();
+#endif
+}
 
-        addBordering(x + 1, y);
-        addBordering(x - 1, y);
-        addBordering(x, y + 1);
-        addBordering(x, y - 1);
-        addBordering(x - 1, y - 1);
-        addBordering(x + 1, y - 1);
-        addBordering(x - 1, y + 1);
-        addBordering(x + 1, y + 1);
-    };
-    for (const auto &tile : tiles)
+void NavigationGrid::waitForRunningRepair()
+{
+    if (!runningRepair) return;
+
+    while (!runningRepairFinished.load(std::memory_order_acquire))
     {
-        visit(tile.x, tile.y);
+        std::this_thread::yield();
     }
+}
+
+void NavigationGrid::finishRunningRepair()
+{
+    if (!runningRepair) return;
+
+    waitForRunningRepair();
+    applyRepair(*runningRepair);
+    runningRepair.reset();
+}
+
+std::unique_ptr<NavigationGrid::Repair> NavigationGrid::createBuild()
+{
+    generation++;
 
-    for (auto node : bordering)
+    auto repair = std::make_unique<Repair>(goal, _goalSize);
+    repair->fromScratch = true;
+    prepareRepair(*repair);
+
+#if NAVIGATION_GRID_CACHE
+    // Grids built before anything has changed on the map are the same in every game with the same starting location
+    if (repair->tileFlags == initialTileFlags)
     {
-        if (node->nextNode)
-        {
-#if DEBUG_LOG_UPDATES
-            Log::Debug() << "Grid-" << goal << ": removeBlocking, enqueued " << node->tile;
+        repair->cacheKey = (std::ostringstream() << "NavigationGrid@" << goal << "x" << _goalSize).str();
+        repair->loadFromCache();
+    }
 #endif
 
-            nodeQueue.emplace(node->cost + COST_STRAIGHT, node, false);
-            nodeQueue.emplace(node->cost + COST_DIAGONAL, node, true);
-        }
-    }
+    return repair;
 }
 
-void NavigationGrid::updateBlockingTiles()
+void NavigationGrid::build()
 {
-    if (pendingBlockingTiles.empty()) return;
+    auto repair = createBuild();
+    repair->run();
+    applyRepair(*repair);
+}
 
-#if DEBUG_LOG_UPDATES
-    Log::Debug() << "Grid-" << goal << ": Updating blocking tiles";
+void NavigationGrid::startRunningRepair(std::unique_ptr<Repair> repair)
+{
+    runningRepair = std::move(repair);
+    runningRepairFinished.store(false, std::memory_order_relaxed);
+
+#if NAVIGATION_GRID_BACKGROUND_REPAIR
+    // A repair works on a copy of the nodes, since the frame thread keeps reading them until the repair is applied
+    repairThreads->enqueue([this, repair = runningRepair.get()]()
+                           {
+                               if (!repair->fromScratch)
+                               {
+                                   repair->costs = costs;
+                                   repair->nextDirections = nextDirections;
+                                   repair->prevNodes = prevNodes;
+                               }
+                               repair->run();
+                               runningRepairFinished.store(true, std::memory_order_release);
+                           });
+#else
+    runningRepair->run();
+    runningRepairFinished.store(true, std::memory_order_release);
 #endif
+}
 
-    // First, invalidate every path that goes through the tiles
-    // Then push all still-valid tiles bordering an invalidated tile to the update queue
-    // When the grid is updated, all of the invalidated tiles will receive a new path from these bordering tiles
+void NavigationGrid::buildInBackground()
+{
+    if (isBuilt() || runningRepair) return;
+
+    startRunningRepair(createBuild());
+}
+
+NavigationGrid::GridNode NavigationGrid::operator[](BWAPI::Position pos) const
+{
+    return {this, (pos.x >> 5) + (pos.y >> 5) * mapWidth};
+}
 
-    std::queue<GridNode *> queue;
-    for (const auto &tile : pendingBlockingTiles)
+NavigationGrid::GridNode NavigationGrid::operator[](BWAPI::WalkPosition pos) const
+{
+    return {this, (pos.x >> 2) + (pos.y >> 2) * mapWidth};
+}
+
+NavigationGrid::GridNode NavigationGrid::operator[](BWAPI::TilePosition pos) const
+{
+    return {this, pos.x + pos.y * mapWidth};
+}
+
+void NavigationGrid::update()
+{
+    lastUsedFrame = currentFrame;
+
+    finishRunningRepair();
+    if (!isBuilt())
     {
-        auto &node = grid[tile.x + tile.y * mapWidth];
-        queue.push(&node);
+        build();
+        return;
     }
 
-    std::set<GridNode *> bordering;
-    auto addBordering = [&](unsigned short x, unsigned short y)
+    if (!pendingRepair) return;
+
+#if OUTPUT_GRID_TIMING
+    auto start = std::chrono::high_resolution_clock::now();
+#endif
+
+    // Nothing else can read the nodes while we are on the frame thread, so repair them in place
+    auto repair = std::move(pendingRepair);
+    prepareRepair(*repair);
+    repair->costs.swap(costs);
+    repair->nextDirections.swap(nextDirections);
+    repair->prevNodes.swap(prevNodes);
+    repair->run();
+    applyRepair(*repair);
+
+#if OUTPUT_GRID_TIMING
+    auto now = std::chrono::high_resolution_clock::now();
+    Log::Get() << "Update navigation grid " << goal << ": " << std::chrono::duration_cast<std::chrono::microseconds>(now - start).count() << "us";
+#endif
+}
+
+void NavigationGrid::updateInBackground()
+{
+#if NAVIGATION_GRID_BACKGROUND_REPAIR
+    lastUsedFrame = currentFrame;
+
+    // The caller needs a grid, so wait for a build in progress or build it now
+    if (!isBuilt())
     {
-        if (x >= mapWidth || y >= mapHeight)
+        finishRunningRepair();
+        if (!isBuilt())
         {
+            build();
             return;
         }
+    }
 
-        bordering.insert(&grid[x + y * mapWidth]);
-    };
-
-    auto visit = [&](NavigationGrid::GridNode *current, unsigned short x, unsigned short y)
+    if (runningRepair && runningRepairFinished.load(std::memory_order_acquire))
     {
-        auto &node = grid[x + y * mapWidth];
+        finishRunningRepair();
+    }
 
-        node.cost = USHRT_MAX;
-        node.nextNode = nullptr;
-        if (node.prevNodes) queue.push(&node);
+    if (runningRepair || !pendingRepair) return;
 
-        addBordering(x + 1, y);
-        addBordering(x - 1, y);
-        addBordering(x, y + 1);
-        addBordering(x, y - 1);
-        addBordering(x - 1, y - 1);
-        addBordering(x + 1, y - 1);
-        addBordering(x - 1, y + 1);
-        addBordering(x + 1, y + 1);
-    };
+    prepareRepair(*pendingRepair);
+    startRunningRepair(std::move(pendingRepair));
+#else
+    update();
+#endif
+}
 
-    while (!queue.empty())
-    {
-        GridNode *current = queue.front();
-        queue.pop();
+void NavigationGrid::addBlockingObject(BWAPI::TilePosition tile, BWAPI::TilePosition size)
+{
+#if DEBUG_LOG_UPDATES
+    Log::Debug() << "Grid-" << goal << ": addBlockingObject(" << tile << "," << size << ")";
+#endif
 
-        if (current->prevNodes & (1U << 1U)) visit(current, current->x - 1, current->y + 1);
-        if (current->prevNodes & (1U << 3U)) visit(current, current->x + 1, current->y + 1);
-        if (current->prevNodes & (1U << 5U)) visit(current, current->x - 1, current->y - 1);
-        if (current->prevNodes & (1U << 7U)) visit(current, current->x + 1, current->y - 1);
+    // Grids that are not built will pick up the current walkability when they are
+    // Grids being built in the background use the walkability from when the build started, so need the change
+    if (!isBuilt() && !runningRepair) return;
 
-        if (current->prevNodes & (1U << 0U)) visit(current, current->x - 1, current->y);
-        if (current->prevNodes & (1U << 2U)) visit(current, current->x + 1, current->y);
-        if (current->prevNodes & (1U << 4U)) visit(current, current->x, current->y - 1);
-        if (current->prevNodes & (1U << 6U)) visit(current, current->x, current->y + 1);
+    pending().blockingObjects.emplace_back(tile, size);
+}
 
-        current->prevNodes = 0;
-    }
+void NavigationGrid::addBlockingTiles(const std::set<BWAPI::TilePosition> &tiles)
+{
+    if (!isBuilt() && !runningRepair) return;
 
-    // Push all valid bordering tiles to the update queue
-    for (auto &borderingNode : bordering)
-    {
-        if (borderingNode->nextNode)
-        {
+    pending().blockingTiles.insert(tiles.begin(), tiles.end());
+}
+
+void NavigationGrid::removeBlockingObject(BWAPI::TilePosition tile, BWAPI::TilePosition size)
+{
 #if DEBUG_LOG_UPDATES
-            Log::Debug() << "Grid-" << goal << ": updateBlockingTiles, enqueued " << borderingNode->tile;
+    Log::Debug() << "Grid-" << goal << ": removeBlockingObject(" << tile << "," << size << ")";
 #endif
 
-            nodeQueue.emplace(borderingNode->cost + COST_STRAIGHT, borderingNode, false);
-            nodeQueue.emplace(borderingNode->cost + COST_DIAGONAL, borderingNode, true);
+    std::set<BWAPI::TilePosition> tiles;
+    for (int x = tile.x; x < tile.x + size.x; x++)
+    {
+        for (int y = tile.y; y < tile.y + size.y; y++)
+        {
+            tiles.insert(BWAPI::TilePosition(x, y));
         }
     }
 
-    pendingBlockingTiles.clear();
+    removeBlockingTiles(tiles);
+}
+
+void NavigationGrid::removeBlockingTiles(const std::set<BWAPI::TilePosition> &tiles)
+{
+    if (!isBuilt() && !runningRepair) return;
+
+    pending().unblockedTiles.insert(tiles.begin(), tiles.end());
 }
 
 void NavigationGrid::dumpHeatmap()
 {
     // Dump to CherryVis
-    std::vector<long> costs(mapWidth * mapHeight);
+    std::vector<long> heatmap(mapWidth * mapHeight);
     for (int y = 0; y < mapHeight; y++)
     {
         for (int x = 0; x < mapWidth; x++)
         {
-            auto cost = grid[x + y * mapWidth].cost;
-            costs[x + y * mapWidth] = cost == USHRT_MAX ? 0 : cost;
+            auto cost = costs[x + y * mapWidth];
+            heatmap[x + y * mapWidth] = cost == USHRT_MAX ? 0 : cost;
         }
     }
 
-    CherryVis::addHeatmap((std::ostringstream() << "Navigation@" << goal).str(), costs, mapWidth, mapHeight);
+    CherryVis::addHeatmap((std::ostringstream() << "Navigation@" << goal).str(), heatmap, mapWidth, mapHeight);
 }
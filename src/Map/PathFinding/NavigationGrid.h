@@ -1,74 +1,119 @@
 #pragma once
 
 #include "Common.h"
-#include <queue>
+#include <array>
+#include <atomic>
+#include <memory>
 
 namespace NavigationGridGlobals
 {
     void initialize();
+
+    // The memory used by the nodes of one built grid
+    size_t gridMemoryUsage();
+
+    // Marks tiles whose walkability has changed, so repairs started after this read their new walkability
+    // Call once per change, before passing it to the grids
+    void tilesChanged(BWAPI::TilePosition tile, BWAPI::TilePosition size);
+    void tilesChanged(const std::set<BWAPI::TilePosition> &tiles);
 }
 
 class NavigationGrid
 {
 public:
-    struct GridNode
+    // Handle to a node in the grid.
+    // Nodes are stored as parallel arrays indexed by x + y * mapWidth, so the handle is just the grid and the index.
+    // A default-constructed handle is the null node, e.g. what nextNode() returns for a node that has no path to the goal.
+    class GridNode
     {
-        unsigned short x;
-        unsigned short y;
-        unsigned short cost;
-        GridNode *nextNode;
-        unsigned char prevNodes;
-        BWAPI::TilePosition tile;
-
-        GridNode(unsigned short x, unsigned short y)
-            : x(x)
-            , y(y)
-            , cost(USHRT_MAX)
-            , nextNode(nullptr)
-            , prevNodes(0)
-            , tile(BWAPI::TilePosition(x, y)) {}
+    public:
+        GridNode() : grid(nullptr), index(-1) {}
 
-        friend std::ostream &operator<<(std::ostream &os, const GridNode &node)
-        {
-            os << "(" << node.x << "," << node.y << ":" << node.cost << ")";
-            if (node.nextNode) os << "->(" << node.nextNode->x << "," << node.nextNode->y << ":" << node.nextNode->cost << ")";
-            return os;
-        }
+        GridNode(const NavigationGrid *grid, int index) : grid(grid), index(index) {}
+
+        explicit operator bool() const { return grid != nullptr; }
+
+        bool operator==(const GridNode &other) const { return grid == other.grid && index == other.index; }
+
+        bool operator!=(const GridNode &other) const { return !(*this == other); }
+
+        [[nodiscard]] int x() const;
+
+        [[nodiscard]] int y() const;
+
+        [[nodiscard]] BWAPI::TilePosition tile() const { return {x(), y()}; }
 
         [[nodiscard]] BWAPI::Position center() const
         {
-            return {(x << 5U) + 16, (y << 5U) + 16};
+            return {(x() << 5U) + 16, (y() << 5U) + 16};
         }
-    };
 
-    typedef std::tuple<unsigned short, GridNode *, bool> QueueItem;
+        [[nodiscard]] unsigned short cost() const { return grid->costs[index]; }
 
-    struct QueueItemComparator
-    {
-        bool operator()(QueueItem &a, QueueItem &b) const
+        [[nodiscard]] GridNode nextNode() const;
+
+        friend std::ostream &operator<<(std::ostream &os, const GridNode &node)
         {
-            return std::get<0>(a) > std::get<0>(b);
+            os << "(" << node.x() << "," << node.y() << ":" << node.cost() << ")";
+            if (auto next = node.nextNode()) os << "->(" << next.x() << "," << next.y() << ":" << next.cost() << ")";
+            return os;
         }
+
+    private:
+        const NavigationGrid *grid;
+        int index;
     };
 
     BWAPI::TilePosition goal;
 
+    // Incremented every time the grid nodes are (re)built, so holders of node handles can detect when they are stale
+    unsigned int generation;
+
+    // The last frame the grid was updated or queried through update()
+    int lastUsedFrame;
+
+    // Whether the current nodes were loaded from the map data cache instead of being computed
+    bool loadedFromCache;
+
+    // The grid nodes are not built until the first call to update() or buildInBackground()
     explicit NavigationGrid(BWAPI::TilePosition goal, BWAPI::TilePosition goalSize = BWAPI::TilePositions::Invalid);
 
-    GridNode &operator[](BWAPI::Position pos);
+    ~NavigationGrid();
+
+    NavigationGrid(const NavigationGrid &) = delete;
+
+    NavigationGrid &operator=(const NavigationGrid &) = delete;
+
+    [[nodiscard]] bool isBuilt() const { return !costs.empty(); }
 
-    const GridNode &operator[](BWAPI::Position pos) const;
+    [[nodiscard]] BWAPI::TilePosition goalSize() const { return _goalSize; }
 
-    GridNode &operator[](BWAPI::WalkPosition pos);
+    [[nodiscard]] size_t memoryUsage() const;
 
-    const GridNode &operator[](BWAPI::WalkPosition pos) const;
+    // Whether the grid is being repaired on the background thread
+    [[nodiscard]] bool isRepairing() const { return runningRepair != nullptr; }
 
-    GridNode &operator[](BWAPI::TilePosition pos);
+    // Frees the grid nodes; they will be rebuilt from the current map walkability on the next call to update()
+    void release();
 
-    const GridNode &operator[](BWAPI::TilePosition pos) const;
+    GridNode operator[](BWAPI::Position pos) const;
 
+    GridNode operator[](BWAPI::WalkPosition pos) const;
+
+    GridNode operator[](BWAPI::TilePosition pos) const;
+
+    // Brings the grid up-to-date with all blocking changes, waiting for any background repair to finish
     void update();
 
+    // Applies the result of a finished background repair and starts a new one if there are blocking changes since the last one.
+    // Until a repair is applied, readers see the last consistent version of the grid.
+    // Grids that have not been built yet are built synchronously.
+    void updateInBackground();
+
+    // Starts building the grid on a background thread if it has not been built yet
+    // The first update waits for the build to finish if needed
+    void buildInBackground();
+
     void addBlockingObject(BWAPI::TilePosition tile, BWAPI::TilePosition size);
 
     void addBlockingTiles(const std::set<BWAPI::TilePosition> &tiles);
@@ -78,10 +123,41 @@ public:
     void removeBlockingTiles(const std::set<BWAPI::TilePosition> &tiles);
 
 private:
-    std::vector<GridNode> grid;
-    std::priority_queue<QueueItem, std::vector<QueueItem>, QueueItemComparator> nodeQueue;
-    std::set<BWAPI::TilePosition> pendingBlockingTiles;
+    // Queue items pack the cost, node index and whether to consider diagonal edges into 8 bytes, ordered by cost
+    typedef unsigned long long QueueItem;
+
+    // Size of the bucket queue window; must be larger than the largest edge cost
+    static constexpr int BUCKET_COUNT = 64;
+
+    struct Repair;
+
+    BWAPI::TilePosition _goalSize;
+
+    // Cost to the goal, USHRT_MAX if there is no path
+    std::vector<unsigned short> costs;
+
+    // Direction from the next node to this node, with NEXT_NODE_VALID set if the node has a next node
+    std::vector<unsigned char> nextDirections;
+
+    // Bitmask of the directions from this node to the nodes that have it as their next node
+    std::vector<unsigned char> prevNodes;
+
+    // Blocking changes since the last repair was started
+    std::unique_ptr<Repair> pendingRepair;
+
+    // The repair running on the background thread, which sets runningRepairFinished when it is done
+    std::unique_ptr<Repair> runningRepair;
+    std::atomic<bool> runningRepairFinished;
+
+    [[nodiscard]] int nextIndex(int index) const;
 
-    void updateBlockingTiles();
+    Repair &pending();
+    void prepareRepair(Repair &repair);
+    void applyRepair(Repair &repair);
+    void waitForRunningRepair();
+    void finishRunningRepair();
+    void startRunningRepair(std::unique_ptr<Repair> repair);
+    std::unique_ptr<Repair> createBuild();
+    void build();
     void dumpHeatmap();
 };
@@ -11,16 +11,16 @@ namespace PathFinding
         if (grid)
         {
             // Advance the desired number of nodes
-            auto node = &(*grid)[start];
+            auto node = (*grid)[start];
             for (int i = 0; node && i < nodesAhead; i++)
             {
-                node = node->nextNode;
+                node = node.nextNode();
             }
 
             if (node)
             {
                 auto startTile = BWAPI::TilePosition(start);
-                return start + BWAPI::Position(node->tile - startTile);
+                return start + BWAPI::Position(node.tile() - startTile);
             }
         }
 
@@ -2,6 +2,7 @@
 
 #include "Common.h"
 #include "NavigationGrid.h"
+#include "TileBitset.h"
 #include "Choke.h"
 #include <bwem.h>
 
@@ -10,21 +11,27 @@ namespace PathFinding
     // Clears grids, call at start before initializing Map
     void clearGrids();
 
-    // Initializes the navigation grids
+    // Registers the navigation grids; each grid is built the first time it is requested
     void initializeGrids();
 
+    // Sets the memory limit for built navigation grids, beyond which the least recently used grids are released
+    void setNavigationGridMemoryLimit(size_t bytes);
+
     // Gets the navigation grid to a specific goal position
-    NavigationGrid *getNavigationGrid(BWAPI::TilePosition goal, bool ignoreEnemyBuildings = false);
-    NavigationGrid *getNavigationGrid(BWAPI::Position goal, bool ignoreEnemyBuildings = false);
+    // Grids are repaired on a background thread after blocking changes, so by default the returned grid may not yet reflect
+    // changes made in this or recent frames. Pass waitForRepair if the grid must be up-to-date.
+    // Enemy buildings are not tracked separately from other blocking objects, so ignoreEnemyBuildings gets the same grid.
+    NavigationGrid *getNavigationGrid(BWAPI::TilePosition goal, bool ignoreEnemyBuildings = false, bool waitForRepair = false);
+    NavigationGrid *getNavigationGrid(BWAPI::Position goal, bool ignoreEnemyBuildings = false, bool waitForRepair = false);
 
     // An object that affects pathfinding (e.g. a building) has been added
-    void addBlockingObject(BWAPI::UnitType type, BWAPI::TilePosition tile, bool isEnemyBuilding = false);
+    void addBlockingObject(BWAPI::UnitType type, BWAPI::TilePosition tile);
 
     // Tiles that affect pathfinding (e.g. a mineral line) have been added
     void addBlockingTiles(const std::set<BWAPI::TilePosition> &tiles);
 
     // An object that affects pathfinding (e.g. a building) has been removed
-    void removeBlockingObject(BWAPI::UnitType type, BWAPI::TilePosition tile, bool isEnemyBuilding = false);
+    void removeBlockingObject(BWAPI::UnitType type, BWAPI::TilePosition tile);
 
     // Tiles that affect pathfinding (e.g. a mineral line) have been removed
     void removeBlockingTiles(const std::set<BWAPI::TilePosition> &tiles);
@@ -55,6 +62,14 @@ namespace PathFinding
             BWAPI::UnitType unitType = BWAPI::UnitTypes::Protoss_Dragoon,
             PathFindingOptions options = PathFindingOptions::Default);
 
+    // Gets the ground distances from the start to each of the ends, the same as calling GetGroundDistance for each.
+    // Ends without a navigation grid share a single choke point search from the start.
+    std::vector<int> GetGroundDistances(
+            BWAPI::Position start,
+            const std::vector<BWAPI::Position> &ends,
+            BWAPI::UnitType unitType = BWAPI::UnitTypes::Protoss_Dragoon,
+            PathFindingOptions options = PathFindingOptions::Default);
+
     // Gets a path between two points as a list of choke points between them.
     // Returns an empty path if the two points are in the same BWEM area or if there is no valid path.
     // By default, if either of the ends doesn't have a valid BWEM area, the method will return an empty path.
@@ -99,17 +114,70 @@ namespace PathFinding
             PathFindingOptions options,
             int defaultIfInaccessible);
 
+    // Reusable per-tile state for path searches.
+    // Tiles are stamped with the generation of the search that last wrote them, so starting a search is O(1) instead of clearing
+    // the whole map. Searches using different contexts are independent, so they can run concurrently on different threads.
+    class SearchContext
+    {
+    public:
+        explicit SearchContext(int mapWidth = 0, int mapHeight = 0);
+
+        [[nodiscard]] int width() const { return mapWidth; }
+
+        [[nodiscard]] int height() const { return mapHeight; }
+
+        // Starts a new search, forgetting all tiles visited by previous searches
+        void startSearch();
+
+        [[nodiscard]] bool visited(int index) const { return generations[index] == generation; }
+
+        // The tile the given tile was reached from in this search, or None if it has not been visited
+        [[nodiscard]] BWAPI::TilePosition parent(int index) const
+        {
+            return visited(index) ? parents[index] : BWAPI::TilePositions::None;
+        }
+
+        // The distance to the given tile in this search, or INT_MAX if it has not been visited
+        [[nodiscard]] int dist(int index) const { return visited(index) ? dists[index] : INT_MAX; }
+
+        void visit(int index, BWAPI::TilePosition parent, int dist)
+        {
+            generations[index] = generation;
+            parents[index] = parent;
+            dists[index] = dist;
+        }
+
+    private:
+        int mapWidth;
+        int mapHeight;
+        unsigned int generation;
+        std::vector<unsigned int> generations;
+        std::vector<BWAPI::TilePosition> parents;
+        std::vector<int> dists;
+    };
+
     // Initializes the path finding search
     void initializeSearch();
 
     // Searches for the shortest path from start to end.
     // If a tileValidator is passed, only tiles for which it returns true can be part of the returned path.
     // If a closeEnoughToEnd predicate is specified, the search will stop as soon as a node is found for which it returns true.
+    // Searches without a context use a shared one, so may only be run on the frame thread.
     std::vector<BWAPI::TilePosition> Search(BWAPI::TilePosition start,
                                             BWAPI::TilePosition end,
                                             const std::function<bool(const BWAPI::TilePosition &)> &tileValidator = nullptr,
                                             const std::function<bool(const BWAPI::TilePosition &)> &closeEnoughToEnd = nullptr,
-                                            int maxBacktracking = 500);
+                                            int maxBacktracking = 500,
+                                            SearchContext *context = nullptr);
+
+    // Searches for the shortest path from start to end through the tiles set in validTiles.
+    // Uses jump point search, so is much faster than the tileValidator variant on long paths through open terrain.
+    // Jump points more than maxBacktracking tiles further from the end than the start are pruned.
+    std::vector<BWAPI::TilePosition> Search(BWAPI::TilePosition start,
+                                            BWAPI::TilePosition end,
+                                            const TileBitset &validTiles,
+                                            int maxBacktracking = 500,
+                                            SearchContext *context = nullptr);
 
     // Gets a "waypoint" a specified number of nodes ahead in a navigation grid.
     // If the grid is not available, falls back to a chokepoint-based approach.
@@ -71,33 +71,97 @@ namespace PathFinding
             return BWAPI::Positions::Invalid;
         }
 
-        // Creates a BWEM-style choke point path using an algorithm similar to BWEB's tile-resolution path finding.
+        // Creates BWEM-style choke point paths using an algorithm similar to BWEB's tile-resolution path finding.
         // Used when we want to generate paths with additional constraints beyond what BWEM provides, like taking
         // choke width and mineral walking into consideration.
-        BWEM::CPPath CustomChokePointPath(
-                BWAPI::Position start,
-                BWAPI::Position end,
-                PathFindingOptions options,
-                BWAPI::UnitType unitType,
-                int *pathLength)
+        // The search from the start is kept between calls, so paths to more targets continue the same search instead of
+        // starting over. Since the order in which chokes are visited doesn't depend on the target, the results are the same as
+        // doing a separate search for each target.
+        class ChokePointSearch
         {
-            if (pathLength) *pathLength = -1;
-
-            const BWEM::Area *startArea = useNearestBWEMArea(options) ? BWEM::Map::Instance().GetNearestArea(BWAPI::WalkPosition(start))
-                                                                      : BWEM::Map::Instance().GetArea(BWAPI::WalkPosition(start));
-            const BWEM::Area *targetArea = useNearestBWEMArea(options) ? BWEM::Map::Instance().GetNearestArea(BWAPI::WalkPosition(end))
-                                                                       : BWEM::Map::Instance().GetArea(BWAPI::WalkPosition(end));
-            if (!startArea || !targetArea)
+        public:
+            ChokePointSearch(BWAPI::Position start, PathFindingOptions options, BWAPI::UnitType unitType)
+                    : start(start)
+                    , options(options)
+                    , unitType(unitType)
+                    , nodeQueue(cmp)
             {
-                return {};
+                startArea = useNearestBWEMArea(options) ? BWEM::Map::Instance().GetNearestArea(BWAPI::WalkPosition(start))
+                                                        : BWEM::Map::Instance().GetArea(BWAPI::WalkPosition(start));
+                if (!startArea) return;
+
+                for (auto choke : startArea->ChokePoints())
+                {
+                    if (validChoke(choke, unitType.width(), unitType.isWorker()))
+                        nodeQueue.emplace(
+                                choke,
+                                start.getApproxDistance(BWAPI::Position(choke->Center())),
+                                chokeTo(choke, startArea),
+                                nullptr);
+                }
             }
 
-            if (startArea == targetArea)
+            BWEM::CPPath pathTo(BWAPI::Position end, int *pathLength)
             {
-                if (pathLength) *pathLength = start.getApproxDistance(end);
+                if (pathLength) *pathLength = -1;
+
+                const BWEM::Area *targetArea = useNearestBWEMArea(options) ? BWEM::Map::Instance().GetNearestArea(BWAPI::WalkPosition(end))
+                                                                           : BWEM::Map::Instance().GetArea(BWAPI::WalkPosition(end));
+                if (!startArea || !targetArea)
+                {
+                    return {};
+                }
+
+                if (startArea == targetArea)
+                {
+                    if (pathLength) *pathLength = start.getApproxDistance(end);
+                    return {};
+                }
+
+                auto result = [&](const Node &node)
+                {
+                    // We're ignoring the distance from this last choke to the target position; it's an unlikely
+                    // edge case that there is an alternate choke giving a significantly better result
+                    if (pathLength) *pathLength = node.dist + end.getApproxDistance(BWAPI::Position(node.choke->Center()));
+                    return createPath(node);
+                };
+
+                // We may have already reached the target area while searching for a previous target
+                auto it = firstNodeInArea.find(targetArea);
+                if (it != firstNodeInArea.end()) return result(it->second);
+
+                while (!nodeQueue.empty())
+                {
+                    auto const current = nodeQueue.top();
+                    nodeQueue.pop();
+
+                    // If already has a parent, continue
+                    if (parentMap.contains(current.choke)) continue;
+
+                    // Set parent
+                    parentMap[current.choke] = current.parent;
+                    firstNodeInArea.try_emplace(current.toArea, current);
+
+                    // Add valid connected chokes we haven't visited yet
+                    // This is done before checking for the target, so the search can be continued for later targets
+                    for (auto choke : current.toArea->ChokePoints())
+                    {
+                        if (validChoke(choke, unitType.width(), unitType.isWorker()) && !parentMap.contains(choke))
+                            nodeQueue.emplace(
+                                    choke,
+                                    current.dist + BWAPI::Position(choke->Center()).getApproxDistance(BWAPI::Position(current.choke->Center())),
+                                    chokeTo(choke, current.toArea),
+                                    current.choke);
+                    }
+
+                    // If at target, return path
+                    if (current.toArea == targetArea) return result(current);
+                }
+
                 return {};
             }
 
+        private:
             struct Node
             {
                 Node(const BWEM::ChokePoint *choke, int const dist, const BWEM::Area *toArea, const BWEM::ChokePoint *parent)
@@ -109,14 +173,16 @@ namespace PathFinding
                 mutable const BWEM::ChokePoint *parent = nullptr;
             };
 
-            const auto chokeTo = [](const BWEM::ChokePoint *choke, const BWEM::Area *from)
+            static bool cmp(const Node &left, const Node &right) { return left.dist > right.dist; }
+
+            static const BWEM::Area *chokeTo(const BWEM::ChokePoint *choke, const BWEM::Area *from)
             {
                 return (from == choke->GetAreas().first)
                        ? choke->GetAreas().second
                        : choke->GetAreas().first;
-            };
+            }
 
-            const auto createPath = [](const Node &node, std::map<const BWEM::ChokePoint *, const BWEM::ChokePoint *> &parentMap)
+            BWEM::CPPath createPath(const Node &node)
             {
                 std::vector<const BWEM::ChokePoint *> path;
                 const BWEM::ChokePoint *current = node.choke;
@@ -130,80 +196,120 @@ namespace PathFinding
                 std::reverse(path.begin(), path.end());
 
                 return path;
-            };
-
-            auto cmp = [](Node left, Node right)
-            { return left.dist > right.dist; };
-            std::priority_queue<Node, std::vector<Node>, decltype(cmp)> nodeQueue(cmp);
-            for (auto choke : startArea->ChokePoints())
-            {
-                if (validChoke(choke, unitType.width(), unitType.isWorker()))
-                    nodeQueue.emplace(
-                            choke,
-                            start.getApproxDistance(BWAPI::Position(choke->Center())),
-                            chokeTo(choke, startArea),
-                            nullptr);
             }
 
+            BWAPI::Position start;
+            PathFindingOptions options;
+            BWAPI::UnitType unitType;
+            const BWEM::Area *startArea;
+            std::priority_queue<Node, std::vector<Node>, decltype(&cmp)> nodeQueue;
             std::map<const BWEM::ChokePoint *, const BWEM::ChokePoint *> parentMap;
 
-            while (!nodeQueue.empty())
-            {
-                auto const current = nodeQueue.top();
-                nodeQueue.pop();
+            // The first node popped into each area, which is where the search would stop if the area were the target
+            std::map<const BWEM::Area *, Node> firstNodeInArea;
+        };
+
+        // Implements GetChokePointPath, using the given search from the start if our own choke point search is needed.
+        // If the given search is null, it is created.
+        BWEM::CPPath chokePointPath(
+                BWAPI::Position start,
+                BWAPI::Position end,
+                BWAPI::UnitType unitType,
+                PathFindingOptions options,
+                int *pathLength,
+                std::unique_ptr<ChokePointSearch> &search)
+        {
+            if (pathLength) *pathLength = -1;
 
-                // If already has a parent, continue
-                if (parentMap.contains(current.choke)) continue;
+            // Adjust the start and end positions based on the options
+            auto adjustedStart = adjustForBWEMPathFinding(start, options);
+            auto adjustedEnd = adjustForBWEMPathFinding(end, options);
+            if (adjustedStart == BWAPI::Positions::Invalid || adjustedEnd == BWAPI::Positions::Invalid) return {};
 
-                // Set parent
-                parentMap[current.choke] = current.parent;
+            // Start with the BWEM path
+            auto &bwemPath = BWEM::Map::Instance().GetPath(adjustedStart, adjustedEnd, pathLength);
 
-                // If at target, return path
-                // We're ignoring the distance from this last choke to the target position; it's an unlikely
-                // edge case that there is an alternate choke giving a significantly better result
-                if (current.toArea == targetArea)
-                {
-                    if (pathLength) *pathLength = current.dist + end.getApproxDistance(BWAPI::Position(current.choke->Center()));
-                    return createPath(current, parentMap);
-                }
+            // We can always use BWEM's default pathfinding if:
+            // - The minimum choke width is equal to or greater than the unit width
+            // - The map doesn't have mineral walking chokes or the unit can't mineral walk
+            // An exception to the second case is Plasma, where BWEM doesn't mark the mineral walking chokes as blocked
+            bool canUseBwemPath =
+                    std::max(unitType.width(), unitType.height()) <= Map::minChokeWidth() &&
+                    Map::mapSpecificOverride()->canUseBwemPath(unitType);
 
-                // Add valid connected chokes we haven't visited yet
-                for (auto choke : current.toArea->ChokePoints())
+            // If we can't automatically use it, validate the chokes
+            if (!canUseBwemPath && !bwemPath.empty())
+            {
+                canUseBwemPath = true;
+                for (auto choke : bwemPath)
                 {
-                    if (validChoke(choke, unitType.width(), unitType.isWorker()) && !parentMap.contains(choke))
-                        nodeQueue.emplace(
-                                choke,
-                                current.dist + BWAPI::Position(choke->Center()).getApproxDistance(BWAPI::Position(current.choke->Center())),
-                                chokeTo(choke, current.toArea),
-                                current.choke);
+                    if (!validChoke(choke, unitType.width(), unitType.isWorker()))
+                    {
+                        canUseBwemPath = false;
+                        break;
+                    }
                 }
             }
 
-            return {};
+            // Use BWEM path if it is usable
+            if (canUseBwemPath)
+                return bwemPath;
+
+            // Otherwise do our own path analysis
+            if (!search) search = std::make_unique<ChokePointSearch>(adjustedStart, options, unitType);
+            return search->pathTo(adjustedEnd, pathLength);
+        }
+
+        // Implements GetGroundDistance for the given grid to the end, which may be null
+        int groundDistance(BWAPI::Position start,
+                           BWAPI::Position end,
+                           BWAPI::UnitType unitType,
+                           PathFindingOptions options,
+                           NavigationGrid *grid,
+                           std::unique_ptr<ChokePointSearch> &search)
+        {
+            // Use grid cost if we have one, regardless of input options
+            if (grid)
+            {
+                auto cost = (*grid)[start].cost();
+                if (cost < USHRT_MAX) return cost;
+            }
+
+            // Adjust the start and end positions based on the options
+            auto adjustedStart = adjustForBWEMPathFinding(start, options);
+            auto adjustedEnd = adjustForBWEMPathFinding(end, options);
+            if (adjustedStart == BWAPI::Positions::Invalid || adjustedEnd == BWAPI::Positions::Invalid)
+            {
+                return start.getApproxDistance(end);
+            }
+
+            int dist;
+            chokePointPath(start, end, unitType, options, &dist, search);
+            return dist;
         }
     }
 
     int GetGroundDistance(BWAPI::Position start, BWAPI::Position end, BWAPI::UnitType unitType, PathFindingOptions options)
     {
-        // Use grid cost if we have one, regardless of input options
-        auto grid = getNavigationGrid(end);
-        if (grid)
-        {
-            auto cost = (*grid)[start].cost;
-            if (cost < USHRT_MAX) return cost;
-        }
+        std::unique_ptr<ChokePointSearch> search;
+        return groundDistance(start, end, unitType, options, getNavigationGrid(end), search);
+    }
+
+    std::vector<int> GetGroundDistances(BWAPI::Position start,
+                                        const std::vector<BWAPI::Position> &ends,
+                                        BWAPI::UnitType unitType,
+                                        PathFindingOptions options)
+    {
+        std::vector<int> result;
+        result.reserve(ends.size());
 
-        // Adjust the start and end positions based on the options
-        auto adjustedStart = adjustForBWEMPathFinding(start, options);
-        auto adjustedEnd = adjustForBWEMPathFinding(end, options);
-        if (adjustedStart == BWAPI::Positions::Invalid || adjustedEnd == BWAPI::Positions::Invalid)
+        std::unique_ptr<ChokePointSearch> search;
+        for (const auto &end : ends)
         {
-            return start.getApproxDistance(end);
+            result.push_back(groundDistance(start, end, unitType, options, getNavigationGrid(end), search));
         }
 
-        int dist;
-        GetChokePointPath(start, end, unitType, options, &dist);
-        return dist;
+        return result;
     }
 
     BWEM::CPPath GetChokePointPath(
@@ -213,44 +319,8 @@ namespace PathFinding
             PathFindingOptions options,
             int *pathLength)
     {
-        if (pathLength) *pathLength = -1;
-
-        // Adjust the start and end positions based on the options
-        auto adjustedStart = adjustForBWEMPathFinding(start, options);
-        auto adjustedEnd = adjustForBWEMPathFinding(end, options);
-        if (adjustedStart == BWAPI::Positions::Invalid || adjustedEnd == BWAPI::Positions::Invalid) return {};
-
-        // Start with the BWEM path
-        auto &bwemPath = BWEM::Map::Instance().GetPath(adjustedStart, adjustedEnd, pathLength);
-
-        // We can always use BWEM's default pathfinding if:
-        // - The minimum choke width is equal to or greater than the unit width
-        // - The map doesn't have mineral walking chokes or the unit can't mineral walk
-        // An exception to the second case is Plasma, where BWEM doesn't mark the mineral walking chokes as blocked
-        bool canUseBwemPath =
-                std::max(unitType.width(), unitType.height()) <= Map::minChokeWidth() &&
-                Map::mapSpecificOverride()->canUseBwemPath(unitType);
-
-        // If we can't automatically use it, validate the chokes
-        if (!canUseBwemPath && !bwemPath.empty())
-        {
-            canUseBwemPath = true;
-            for (auto choke : bwemPath)
-            {
-                if (!validChoke(choke, unitType.width(), unitType.isWorker()))
-                {
-                    canUseBwemPath = false;
-                    break;
-                }
-            }
-        }
-
-        // Use BWEM path if it is usable
-        if (canUseBwemPath)
-            return bwemPath;
-
-        // Otherwise do our own path analysis
-        return CustomChokePointPath(adjustedStart, adjustedEnd, options, unitType, pathLength);
+        std::unique_ptr<ChokePointSearch> search;
+        return chokePointPath(start, end, unitType, options, pathLength, search);
     }
 
     Choke *SeparatingNarrowChoke(
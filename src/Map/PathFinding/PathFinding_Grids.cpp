@@ -4,23 +4,76 @@
 
 #if INSTRUMENTATION_ENABLED
 #define OUTPUT_GRID_TIMING false
+#define DEBUG_GRID_POOL false
 #endif
 
+// Default limit on the memory used by built navigation grids
+#define NAVIGATION_GRID_MEMORY_LIMIT_MB 16
+
 namespace PathFinding
 {
     namespace
     {
-        std::map<BWAPI::TilePosition, std::pair<NavigationGrid, NavigationGrid>> goalToNavigationGrid;
+        // Grids are registered for each goal at startup, but only built when first requested
+        std::map<BWAPI::TilePosition, NavigationGrid> goalToNavigationGrids;
+        size_t memoryLimit = (size_t)NAVIGATION_GRID_MEMORY_LIMIT_MB * 1024 * 1024;
 
         void createNavigationGrid(BWAPI::TilePosition goal, BWAPI::TilePosition goalSize = BWAPI::TilePositions::Invalid)
         {
-            goalToNavigationGrid.emplace(goal, std::make_pair(NavigationGrid(goal, goalSize), NavigationGrid(goal, goalSize)));
+            goalToNavigationGrids.try_emplace(goal, goal, goalSize);
+        }
+
+        template<typename F>
+        void forEachGrid(F &&f)
+        {
+            for (auto &goalAndNavigationGrid : goalToNavigationGrids)
+            {
+                f(goalAndNavigationGrid.second);
+            }
+        }
+
+        // Releases the least recently used grids until the built grids fit in the memory limit
+        // Grids used this frame are never released, so pointers to grids and their nodes are valid until the end of the frame
+        void evictColdGrids()
+        {
+            size_t memoryUsage = 0;
+            std::vector<NavigationGrid *> candidates;
+            forEachGrid([&](NavigationGrid &grid)
+            {
+                if (!grid.isBuilt()) return;
+
+                memoryUsage += grid.memoryUsage();
+                if (grid.lastUsedFrame < currentFrame && !grid.isRepairing()) candidates.push_back(&grid);
+            });
+
+            if (memoryUsage <= memoryLimit) return;
+
+            std::sort(candidates.begin(), candidates.end(), [](const NavigationGrid *a, const NavigationGrid *b)
+            {
+                return a->lastUsedFrame < b->lastUsedFrame;
+            });
+            for (auto grid : candidates)
+            {
+                if (memoryUsage <= memoryLimit) break;
+
+#if DEBUG_GRID_POOL
+                Log::Debug() << "Evicting navigation grid " << grid->goal << " last used @ " << grid->lastUsedFrame;
+#endif
+
+                memoryUsage -= grid->memoryUsage();
+                grid->release();
+            }
         }
     }
 
     void clearGrids()
     {
-        goalToNavigationGrid.clear();
+        goalToNavigationGrids.clear();
+    }
+
+    void setNavigationGridMemoryLimit(size_t bytes)
+    {
+        memoryLimit = bytes;
     }
 
     void initializeGrids()
@@ -37,41 +90,85 @@ namespace PathFinding
 
             createNavigationGrid(BWAPI::TilePosition(choke->center));
         }
+
+        // Start building the grids we are likely to need early in the game on the background threads, so they are built in
+        // parallel with each other and with the rest of startup, instead of one-by-one when first requested
+        // Grids to our own bases and chokes come first, then the other starting locations, then everything else
+        std::vector<BWAPI::TilePosition> goals;
+        auto addGoal = [&goals](BWAPI::TilePosition goal)
+        {
+            if (goalToNavigationGrids.contains(goal) && std::find(goals.begin(), goals.end(), goal) == goals.end())
+            {
+                goals.push_back(goal);
+            }
+        };
+        if (Map::getMyMain()) addGoal(BWAPI::TilePosition(Map::getMyMain()->getPosition()));
+        if (Map::getMyNatural()) addGoal(BWAPI::TilePosition(Map::getMyNatural()->getPosition()));
+        if (Map::getMyMainChoke()) addGoal(BWAPI::TilePosition(Map::getMyMainChoke()->center));
+        for (auto base : Map::allStartingLocations())
+        {
+            addGoal(BWAPI::TilePosition(base->getPosition()));
+            if (auto natural = Map::getStartingBaseNatural(base)) addGoal(BWAPI::TilePosition(natural->getPosition()));
+        }
+        for (auto &goalAndNavigationGrids : goalToNavigationGrids)
+        {
+            addGoal(goalAndNavigationGrids.first);
+        }
+
+        // Stay within the memory limit, so none of them are evicted before they are used
+        size_t gridsToBuild = std::min(goals.size(), memoryLimit / NavigationGridGlobals::gridMemoryUsage());
+        for (size_t i = 0; i < gridsToBuild; i++)
+        {
+            goalToNavigationGrids.find(goals[i])->second.buildInBackground();
+        }
+
+#if DEBUG_GRID_POOL
+        Log::Debug() << "Building " << gridsToBuild << " of " << goalToNavigationGrids.size() << " navigation grids in the background";
+#endif
     }
 
-    NavigationGrid *getNavigationGrid(BWAPI::TilePosition goal, bool ignoreEnemyBuildings)
+    NavigationGrid *getNavigationGrid(BWAPI::TilePosition goal, bool ignoreEnemyBuildings, bool waitForRepair)
     {
-        auto gridIt = goalToNavigationGrid.find(goal);
-        if (gridIt == goalToNavigationGrid.end()) return nullptr;
+        auto gridIt = goalToNavigationGrids.find(goal);
+        if (gridIt == goalToNavigationGrids.end()) return nullptr;
+
+        // Blocking objects are not flagged as enemy buildings, so there is a single grid per goal regardless of ignoreEnemyBuildings
+        auto grid = &gridIt->second;
 
-        auto &grid = ignoreEnemyBuildings ? gridIt->second.second : gridIt->second.first;
-        grid.update();
-        return &grid;
+        bool wasBuilt = grid->isBuilt();
+        if (waitForRepair)
+        {
+            grid->update();
+        }
+        else
+        {
+            grid->updateInBackground();
+        }
+        if (!wasBuilt) evictColdGrids();
+        return grid;
     }
 
-    NavigationGrid *getNavigationGrid(BWAPI::Position goal, bool ignoreEnemyBuildings)
+    NavigationGrid *getNavigationGrid(BWAPI::Position goal, bool ignoreEnemyBuildings, bool waitForRepair)
     {
-        return getNavigationGrid(BWAPI::TilePosition(goal), ignoreEnemyBuildings);
+        return getNavigationGrid(BWAPI::TilePosition(goal), ignoreEnemyBuildings, waitForRepair);
     }
 
-    void addBlockingObject(BWAPI::UnitType type, BWAPI::TilePosition tile, bool isEnemyBuilding)
+    void addBlockingObject(BWAPI::UnitType type, BWAPI::TilePosition tile)
     {
 #if OUTPUT_GRID_TIMING
         auto start = std::chrono::high_resolution_clock::now();
 #endif
 
-        for (auto &goalAndNavigationGrid : goalToNavigationGrid)
+        NavigationGridGlobals::tilesChanged(tile, type.tileSize());
+
+        forEachGrid([&](NavigationGrid &grid)
         {
-            goalAndNavigationGrid.second.first.addBlockingObject(tile, type.tileSize());
-            if (!isEnemyBuilding)
-            {
-                goalAndNavigationGrid.second.second.addBlockingObject(tile, type.tileSize());
-            }
-        }
+            grid.addBlockingObject(tile, type.tileSize());
+        });
 
 #if OUTPUT_GRID_TIMING
         auto now = std::chrono::high_resolution_clock::now();
-        Log::Get() << "addBlockingObject(" << type << ", " << tile << ", enemyBuilding=" << isEnemyBuilding << "): "
+        Log::Get() << "addBlockingObject(" << type << ", " << tile << "): "
             << std::chrono::duration_cast<std::chrono::microseconds>(now - start).count() << "us";
 #endif
     }
@@ -82,11 +179,12 @@ namespace PathFinding
         auto start = std::chrono::high_resolution_clock::now();
 #endif
 
-        for (auto &goalAndNavigationGrid : goalToNavigationGrid)
+        NavigationGridGlobals::tilesChanged(tiles);
+
+        forEachGrid([&tiles](NavigationGrid &grid)
         {
-            goalAndNavigationGrid.second.first.addBlockingTiles(tiles);
-            goalAndNavigationGrid.second.second.addBlockingTiles(tiles);
-        }
+            grid.addBlockingTiles(tiles);
+        });
 
 #if OUTPUT_GRID_TIMING
         auto now = std::chrono::high_resolution_clock::now();
@@ -94,24 +192,22 @@ namespace PathFinding
 #endif
     }
 
-    void removeBlockingObject(BWAPI::UnitType type, BWAPI::TilePosition tile, bool isEnemyBuilding)
+    void removeBlockingObject(BWAPI::UnitType type, BWAPI::TilePosition tile)
     {
 #if OUTPUT_GRID_TIMING
         auto start = std::chrono::high_resolution_clock::now();
 #endif
 
-        for (auto &goalAndNavigationGrid : goalToNavigationGrid)
+        NavigationGridGlobals::tilesChanged(tile, type.tileSize());
+
+        forEachGrid([&](NavigationGrid &grid)
         {
-            goalAndNavigationGrid.second.first.removeBlockingObject(tile, type.tileSize());
-            if (!isEnemyBuilding)
-            {
-                goalAndNavigationGrid.second.second.removeBlockingObject(tile, type.tileSize());
-            }
-        }
+            grid.removeBlockingObject(tile, type.tileSize());
+        });
 
 #if OUTPUT_GRID_TIMING
         auto now = std::chrono::high_resolution_clock::now();
-        Log::Get() << "removeBlockingObject(" << type << ", " << tile << ", enemyBuilding=" << isEnemyBuilding << "): "
+        Log::Get() << "removeBlockingObject(" << type << ", " << tile << "): "
                    << std::chrono::duration_cast<std::chrono::microseconds>(now - start).count() << "us";
 #endif
     }
@@ -122,11 +218,12 @@ namespace PathFinding
         auto start = std::chrono::high_resolution_clock::now();
 #endif
 
-        for (auto &goalAndNavigationGrid : goalToNavigationGrid)
+        NavigationGridGlobals::tilesChanged(tiles);
+
+        forEachGrid([&tiles](NavigationGrid &grid)
         {
-            goalAndNavigationGrid.second.first.removeBlockingTiles(tiles);
-            goalAndNavigationGrid.second.second.removeBlockingTiles(tiles);
-        }
+            grid.removeBlockingTiles(tiles);
+        });
 
 #if OUTPUT_GRID_TIMING
         auto now = std::chrono::high_resolution_clock::now();
@@ -141,13 +238,14 @@ namespace PathFinding
         auto grid = getNavigationGrid(end);
         if (!grid) return true;
 
-        auto node = &(*grid)[start];
+        auto node = (*grid)[start];
         for (int i = 0; i < 1000; i++)
         {
-            if (node->cost < 90) return true;
-            if (!node->nextNode) return false;
-            if (!predicate(*node)) return false;
-            node = node->nextNode;
+            if (node.cost() < 90) return true;
+            auto next = node.nextNode();
+            if (!next) return false;
+            if (!predicate(node)) return false;
+            node = next;
         }
 
         return true;
@@ -2,24 +2,24 @@
 
 #include "Geo.h"
 
+#include <bit>
+
 #if INSTRUMENTATION_ENABLED
 #define OUTPUT_SEARCH_TIMING false
 #endif
 
 namespace
 {
-    std::vector<BWAPI::TilePosition> parents;
-    int nextID;
+    // Used by searches that aren't given a context; only for use on the frame thread
+    PathFinding::SearchContext defaultContext;
 
     struct PathNode
     {
-        PathNode(BWAPI::TilePosition tile, int dist, int estimatedCost)
+        PathNode(BWAPI::TilePosition tile, int dist, int estimatedCost, int id)
                 : tile(tile)
                 , dist(dist)
                 , estimatedCost(estimatedCost)
-        {
-            id = nextID++;
-        }
+                , id(id) {}
 
         BWAPI::TilePosition tile;
         int dist;
@@ -34,21 +34,106 @@ namespace
             return a.estimatedCost > b.estimatedCost || (a.estimatedCost == b.estimatedCost && a.id < b.id);
         }
     };
+
+    // Distance between two tiles on a straight or diagonal line
+    int lineDist(BWAPI::TilePosition a, BWAPI::TilePosition b)
+    {
+        int diff1 = std::abs(a.x - b.x);
+        int diff2 = std::abs(a.y - b.y);
+        if (diff1 > diff2) std::swap(diff1, diff2);
+        return diff2 * 10 + diff1 * 4;
+    }
+
+    // Scans a line of tiles from position 'from' (exclusive) in direction dir, a word at a time.
+    // Returns the position of the first tile that is the target or has a neighbour on one of the sides that is only reachable
+    // optimally through it, or -1 if a blocked tile is reached first.
+    // The sides are the neighbouring lines, or nullptr if they are outside the map.
+    int scanLine(const unsigned long long *line,
+                 const unsigned long long *side1,
+                 const unsigned long long *side2,
+                 int words,
+                 int from,
+                 int dir,
+                 int target)
+    {
+        // A side tile is forced if it is valid and the side tile behind it (in the scan direction) is not
+        auto forced = [&](const unsigned long long *side, int w)
+        {
+            if (!side) return 0ULL;
+            if (dir > 0) return side[w] & ~((side[w] << 1U) | (w > 0 ? side[w - 1] >> 63U : 0ULL));
+            return side[w] & ~((side[w] >> 1U) | (w + 1 < words ? side[w + 1] << 63U : 0ULL));
+        };
+
+        auto stopsInWord = [&](int w)
+        {
+            auto stops = ~line[w] | ((forced(side1, w) | forced(side2, w)) & line[w]);
+            if (target >= 0 && (target >> 6) == w) stops |= 1ULL << (unsigned int)(target & 63);
+            return stops;
+        };
+
+        if (dir > 0)
+        {
+            int first = from + 1;
+            for (int w = first >> 6; w < words; w++)
+            {
+                auto stops = stopsInWord(w);
+                if (w == (first >> 6)) stops &= ~0ULL << (unsigned int)(first & 63);
+                if (!stops) continue;
+
+                int pos = (w << 6) + std::countr_zero(stops);
+                return ((line[w] >> (unsigned int)(pos & 63)) & 1ULL) ? pos : -1;
+            }
+            return -1;
+        }
+
+        int first = from - 1;
+        if (first < 0) return -1;
+        for (int w = first >> 6; w >= 0; w--)
+        {
+            auto stops = stopsInWord(w);
+            if (w == (first >> 6) && (first & 63) < 63) stops &= (1ULL << (unsigned int)((first & 63) + 1)) - 1;
+            if (!stops) continue;
+
+            int pos = (w << 6) + 63 - std::countl_zero(stops);
+            return ((line[w] >> (unsigned int)(pos & 63)) & 1ULL) ? pos : -1;
+        }
+        return -1;
+    }
 }
 
 namespace PathFinding
 {
+    SearchContext::SearchContext(int mapWidth, int mapHeight)
+            : mapWidth(mapWidth)
+            , mapHeight(mapHeight)
+            , generation(0)
+            , generations(mapWidth * mapHeight, 0)
+            , parents(mapWidth * mapHeight)
+            , dists(mapWidth * mapHeight) {}
+
+    void SearchContext::startSearch()
+    {
+        generation++;
+
+        // On wrap-around, clear the stamps so tiles from the searches with the previous use of this generation aren't visited
+        if (generation == 0)
+        {
+            std::fill(generations.begin(), generations.end(), 0);
+            generation = 1;
+        }
+    }
+
     void initializeSearch()
     {
-        parents.clear();
-        parents.resize(BWAPI::Broodwar->mapWidth() * BWAPI::Broodwar->mapHeight());
+        defaultContext = SearchContext(BWAPI::Broodwar->mapWidth(), BWAPI::Broodwar->mapHeight());
     }
 
     std::vector<BWAPI::TilePosition> Search(BWAPI::TilePosition start,
                                             BWAPI::TilePosition end,
                                             const std::function<bool(const BWAPI::TilePosition &)> &tileValidator,
                                             const std::function<bool(const BWAPI::TilePosition &)> &closeEnoughToEnd,
-                                            int maxBacktracking)
+                                            int maxBacktracking,
+                                            SearchContext *context)
     {
 #if OUTPUT_SEARCH_TIMING
         auto startTime = std::chrono::high_resolution_clock::now();
@@ -75,8 +160,13 @@ namespace PathFinding
             return !tileValidator || tileValidator(tile);
         };
 
+        auto &searchContext = context ? *context : defaultContext;
+        searchContext.startSearch();
+        int mapWidth = searchContext.width();
+        int mapHeight = searchContext.height();
+
         std::priority_queue<PathNode, std::vector<PathNode>, PathNodeComparator> nodeQueue;
-        std::fill(parents.begin(), parents.end(), BWAPI::TilePositions::None);
+        int nextID = 0;
 
         auto startDist = distToEnd(start);
         auto distCutoff = startDist + maxBacktracking * 10;
@@ -84,8 +174,8 @@ namespace PathFinding
         auto visit = [&](PathNode &node, BWAPI::TilePosition direction, bool diagonal = false)
         {
             auto tile = node.tile + direction;
-            if (!tile.isValid()) return;
-            if (parents[tile.x + tile.y * BWAPI::Broodwar->mapWidth()] != BWAPI::TilePositions::None) return;
+            if (tile.x < 0 || tile.y < 0 || tile.x >= mapWidth || tile.y >= mapHeight) return;
+            if (searchContext.visited(tile.x + tile.y * mapWidth)) return;
             if (!tileValid(tile)) return;
 
             // Don't allow diagonal connections between blocked tiles
@@ -98,12 +188,12 @@ namespace PathFinding
             if (dist > distCutoff) return;
 
             int newDist = node.dist + (diagonal ? 14 : 10);
-            nodeQueue.emplace(tile, newDist, newDist + dist);
-            parents[tile.x + tile.y * BWAPI::Broodwar->mapWidth()] = node.tile;
+            nodeQueue.emplace(tile, newDist, newDist + dist, nextID++);
+            searchContext.visit(tile.x + tile.y * mapWidth, node.tile, newDist);
         };
 
-        nodeQueue.emplace(start, 0, startDist);
-        parents[start.x + start.y * BWAPI::Broodwar->mapWidth()] = BWAPI::TilePositions::Invalid;
+        nodeQueue.emplace(start, 0, startDist, nextID++);
+        searchContext.visit(start.x + start.y * mapWidth, BWAPI::TilePositions::Invalid, 0);
         while (!nodeQueue.empty())
         {
 #if OUTPUT_SEARCH_TIMING
@@ -121,7 +211,7 @@ namespace PathFinding
                 while (tile != start)
                 {
                     result.push_back(tile);
-                    tile = parents[tile.x + tile.y * BWAPI::Broodwar->mapWidth()];
+                    tile = searchContext.parent(tile.x + tile.y * mapWidth);
                 }
 
                 std::reverse(result.begin(), result.end());
@@ -143,6 +233,178 @@ namespace PathFinding
             visit(current, BWAPI::TilePosition(1, -1), true);
         }
 
+#if OUTPUT_SEARCH_TIMING
+        outputTiming();
+#endif
+
+        return {};
+    }
+
+    std::vector<BWAPI::TilePosition> Search(BWAPI::TilePosition start,
+                                            BWAPI::TilePosition end,
+                                            const TileBitset &validTiles,
+                                            int maxBacktracking,
+                                            SearchContext *context)
+    {
+#if OUTPUT_SEARCH_TIMING
+        auto startTime = std::chrono::high_resolution_clock::now();
+        int count = 0;
+        auto outputTiming = [&]()
+        {
+            auto now = std::chrono::high_resolution_clock::now();
+            Log::Get() << "JPS path from " << start << " to " << end << "; visited " << count << " jump point(s) in "
+                       << std::chrono::duration_cast<std::chrono::microseconds>(now - startTime).count() << "us";
+        };
+#endif
+
+        auto &searchContext = context ? *context : defaultContext;
+        searchContext.startSearch();
+        int mapWidth = searchContext.width();
+
+        // Scans in a straight line, returning the first tile that has a neighbour only reachable optimally through it
+        auto jumpStraight = [&](int x, int y, int dx, int dy)
+        {
+            if (dx != 0)
+            {
+                auto jumpX = scanLine(validTiles.row(y),
+                                      validTiles.row(y - 1),
+                                      validTiles.row(y + 1),
+                                      validTiles.wordsPerRow(),
+                                      x,
+                                      dx,
+                                      y == end.y ? end.x : -1);
+                return jumpX == -1 ? BWAPI::TilePositions::Invalid : BWAPI::TilePosition(jumpX, y);
+            }
+
+            auto jumpY = scanLine(validTiles.column(x),
+                                  validTiles.column(x - 1),
+                                  validTiles.column(x + 1),
+                                  validTiles.wordsPerColumn(),
+                                  y,
+                                  dy,
+                                  x == end.x ? end.y : -1);
+            return jumpY == -1 ? BWAPI::TilePositions::Invalid : BWAPI::TilePosition(x, jumpY);
+        };
+
+        // Scans in a diagonal line, returning the first tile from which a straight scan finds a jump point
+        auto jumpDiagonal = [&](int x, int y, int dx, int dy)
+        {
+            while (true)
+            {
+                // Don't allow diagonal connections between blocked tiles
+                if (!validTiles.get(x + dx, y) || !validTiles.get(x, y + dy)) return BWAPI::TilePositions::Invalid;
+
+                x += dx;
+                y += dy;
+                if (!validTiles.get(x, y)) return BWAPI::TilePositions::Invalid;
+                if (x == end.x && y == end.y) return end;
+
+                if (jumpStraight(x, y, dx, 0).isValid() || jumpStraight(x, y, 0, dy).isValid())
+                {
+                    return BWAPI::TilePosition(x, y);
+                }
+            }
+        };
+
+        std::priority_queue<PathNode, std::vector<PathNode>, PathNodeComparator> nodeQueue;
+        int nextID = 0;
+
+        auto distCutoff = lineDist(start, end) + maxBacktracking * 10;
+
+        auto visit = [&](PathNode &node, int dx, int dy)
+        {
+            auto tile = (dx != 0 && dy != 0) ? jumpDiagonal(node.tile.x, node.tile.y, dx, dy) : jumpStraight(node.tile.x, node.tile.y, dx, dy);
+            if (!tile.isValid()) return;
+
+            auto dist = lineDist(tile, end);
+            if (dist > distCutoff) return;
+
+            auto index = tile.x + tile.y * mapWidth;
+            int newDist = node.dist + lineDist(node.tile, tile);
+            if (newDist >= searchContext.dist(index)) return;
+
+            searchContext.visit(index, node.tile, newDist);
+            nodeQueue.emplace(tile, newDist, newDist + dist, nextID++);
+        };
+
+        nodeQueue.emplace(start, 0, lineDist(start, end), nextID++);
+        searchContext.visit(start.x + start.y * mapWidth, BWAPI::TilePositions::Invalid, 0);
+        while (!nodeQueue.empty())
+        {
+            auto current = nodeQueue.top();
+            nodeQueue.pop();
+
+            // Skip jump points that were queued again with a shorter distance
+            if (current.dist > searchContext.dist(current.tile.x + current.tile.y * mapWidth)) continue;
+
+#if OUTPUT_SEARCH_TIMING
+            count++;
+#endif
+
+            // Return path if we are at the destination, filling in the tiles between the jump points
+            if (current.tile == end)
+            {
+                std::vector<BWAPI::TilePosition> result;
+                BWAPI::TilePosition tile = current.tile;
+                while (tile != start)
+                {
+                    auto parent = searchContext.parent(tile.x + tile.y * mapWidth);
+                    BWAPI::TilePosition step((tile.x > parent.x) - (tile.x < parent.x), (tile.y > parent.y) - (tile.y < parent.y));
+                    for (; tile != parent; tile -= step)
+                    {
+                        result.push_back(tile);
+                    }
+                }
+
+                std::reverse(result.begin(), result.end());
+
+#if OUTPUT_SEARCH_TIMING
+                outputTiming();
+#endif
+
+                return result;
+            }
+
+            // The start expands in all directions; other jump points only in the directions not covered by their parent
+            auto parent = searchContext.parent(current.tile.x + current.tile.y * mapWidth);
+            if (parent == BWAPI::TilePositions::Invalid)
+            {
+                for (int dx = -1; dx <= 1; dx++)
+                {
+                    for (int dy = -1; dy <= 1; dy++)
+                    {
+                        if (dx != 0 || dy != 0) visit(current, dx, dy);
+                    }
+                }
+                continue;
+            }
+
+            int dx = (current.tile.x > parent.x) - (current.tile.x < parent.x);
+            int dy = (current.tile.y > parent.y) - (current.tile.y < parent.y);
+            if (dx != 0 && dy != 0)
+            {
+                visit(current, dx, 0);
+                visit(current, 0, dy);
+                visit(current, dx, dy);
+            }
+            else if (dx != 0)
+            {
+                visit(current, dx, 0);
+                visit(current, dx, 1);
+                visit(current, dx, -1);
+                visit(current, 0, 1);
+                visit(current, 0, -1);
+            }
+            else
+            {
+                visit(current, 0, dy);
+                visit(current, 1, dy);
+                visit(current, -1, dy);
+                visit(current, 1, 0);
+                visit(current, -1, 0);
+            }
+        }
+
 #if OUTPUT_SEARCH_TIMING
         outputTiming();
 #endif
@@ -0,0 +1,74 @@
+#pragma once
+
+#include "Common.h"
+
+// Set of tiles stored as bits, used as a precomputed tile validator for path searches.
+// The bits are kept both by row and by column, so a search can scan a line of tiles in any straight direction a word at a time.
+class TileBitset
+{
+public:
+    TileBitset() : _width(0), _height(0), rowWords(0), columnWords(0) {}
+
+    TileBitset(int width, int height)
+            : _width(width)
+            , _height(height)
+            , rowWords((width + 63) >> 6)
+            , columnWords((height + 63) >> 6)
+            , rows(rowWords * height)
+            , columns(columnWords * width) {}
+
+    [[nodiscard]] int width() const { return _width; }
+
+    [[nodiscard]] int height() const { return _height; }
+
+    [[nodiscard]] bool get(int x, int y) const
+    {
+        if (x < 0 || y < 0 || x >= _width || y >= _height) return false;
+        return (rows[y * rowWords + (x >> 6)] >> (x & 63)) & 1ULL;
+    }
+
+    [[nodiscard]] bool get(BWAPI::TilePosition tile) const { return get(tile.x, tile.y); }
+
+    void set(int x, int y, bool value)
+    {
+        if (x < 0 || y < 0 || x >= _width || y >= _height) return;
+        if (value)
+        {
+            rows[y * rowWords + (x >> 6)] |= 1ULL << (x & 63);
+            columns[x * columnWords + (y >> 6)] |= 1ULL << (y & 63);
+        }
+        else
+        {
+            rows[y * rowWords + (x >> 6)] &= ~(1ULL << (x & 63));
+            columns[x * columnWords + (y >> 6)] &= ~(1ULL << (y & 63));
+        }
+    }
+
+    void set(BWAPI::TilePosition tile, bool value) { set(tile.x, tile.y, value); }
+
+    // The words of a row, where bit i of word w is the tile at x = w * 64 + i; nullptr if the row is outside the bitset
+    [[nodiscard]] const unsigned long long *row(int y) const
+    {
+        if (y < 0 || y >= _height) return nullptr;
+        return &rows[y * rowWords];
+    }
+
+    // The words of a column, where bit i of word w is the tile at y = w * 64 + i; nullptr if the column is outside the bitset
+    [[nodiscard]] const unsigned long long *column(int x) const
+    {
+        if (x < 0 || x >= _width) return nullptr;
+        return &columns[x * columnWords];
+    }
+
+    [[nodiscard]] int wordsPerRow() const { return rowWords; }
+
+    [[nodiscard]] int wordsPerColumn() const { return columnWords; }
+
+private:
+    int _width;
+    int _height;
+    int rowWords;
+    int columnWords;
+    std::vector<unsigned long long> rows;
+    std::vector<unsigned long long> columns;
+};
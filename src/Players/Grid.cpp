@@ -1,5 +1,10 @@
 #include "Grid.h"
 #include <utility>
+#include <algorithm>
+#include <tuple>
+#include <map>
+#include <set>
+#include <unordered_map>
 #include "Geo.h"
 #include "UnitUtil.h"
 
@@ -12,92 +17,416 @@ namespace
 {
     const int STASIS_RANGE = 44;
 
-    std::map<std::pair<BWAPI::UnitType, int>, std::set<BWAPI::WalkPosition>> positionsInRangeCache;
+    // A contiguous run of walk tiles in one column of a footprint, relative to the unit's walk position
+    struct Span
+    {
+        int dx;
+        int dyStart;
+        int length;
+    };
+
+    std::unordered_map<long long, std::vector<Span>> footprintCache;
 
-    std::set<BWAPI::WalkPosition> &getPositionsInRange(BWAPI::UnitType type, int range)
+    std::vector<Span> &getFootprint(BWAPI::UnitType type, int range)
     {
-        std::set<BWAPI::WalkPosition> &positions = positionsInRangeCache[std::make_pair(type, range)];
+        auto [it, inserted] = footprintCache.try_emplace(((long long)type.getID() << 32U) | (unsigned int)range);
+        auto &spans = it->second;
+        if (!inserted) return spans;
+
+        // Collect the walk positions in range of the unit, grouped by column
+        std::map<int, std::set<int>> columns;
+        for (int x = -type.dimensionLeft() - range; x <= type.dimensionRight() + range; x++)
+        {
+            for (int y = -type.dimensionUp() - range; y <= type.dimensionDown() + range; y++)
+            {
+                if (Geo::EdgeToPointDistance(type, BWAPI::Positions::Origin, BWAPI::Position(x, y)) <= range)
+                    columns[x >> 3].insert(y >> 3);
+            }
+        }
 
-        if (positions.empty())
-            for (int x = -type.dimensionLeft() - range; x <= type.dimensionRight() + range; x++)
+        // Convert each column into runs of consecutive rows
+        for (auto &[dx, rows] : columns)
+        {
+            for (int dy : rows)
             {
-                for (int y = -type.dimensionUp() - range; y <= type.dimensionDown() + range; y++)
+                if (!spans.empty() && spans.back().dx == dx && spans.back().dyStart + spans.back().length == dy)
                 {
-                    if (Geo::EdgeToPointDistance(type, BWAPI::Positions::Origin, BWAPI::Position(x, y)) <= range)
-                        positions.insert(BWAPI::WalkPosition(x >> 3U, y >> 3U));
+                    spans.back().length++;
+                }
+                else
+                {
+                    spans.push_back({dx, dy, 1});
                 }
             }
+        }
 
-        return positions;
+        return spans;
     }
 }
 
-void Grid::GridData::add(BWAPI::UnitType type, int range, BWAPI::Position position, int delta)
+template<typename T>
+void Grid::GridData<T>::add(BWAPI::UnitType type, int range, BWAPI::Position position, int delta)
 {
     int startX = position.x >> 3U;
     int startY = position.y >> 3U;
-    for (auto &pos : getPositionsInRange(type, range))
+    auto typedDelta = (T)delta;
+    int minX = maxX, minY = maxY, stampedMaxX = -1, stampedMaxY = -1;
+    for (auto &span : getFootprint(type, range))
     {
-        int x = startX + pos.x;
-        int y = startY + pos.y;
-        if (x >= 0 && x < maxX && y >= 0 && y < maxY)
+        int x = startX + span.dx;
+        if (x < 0 || x >= maxX) continue;
+
+        int yStart = std::max(0, startY + span.dyStart);
+        int yEnd = std::min(maxY, startY + span.dyStart + span.length);
+        if (yStart >= yEnd) continue;
+
+        minX = std::min(minX, x);
+        stampedMaxX = std::max(stampedMaxX, x);
+        minY = std::min(minY, yStart);
+        stampedMaxY = std::max(stampedMaxY, yEnd - 1);
+
+        // Plain loop over contiguous memory, so the compiler can vectorize it
+        T *column = data.data() + x * maxY;
+        for (int y = yStart; y < yEnd; y++)
         {
-            data[x * maxY + y] += delta;
+            column[y] += typedDelta;
+        }
 
 #if LOG_NEGATIVE_VALUES
-            if (data[x * maxY + y] < 0)
-            {
-                Log::Get() << "Negative grid value @ " << BWAPI::Position(x, y) << "\n"
-                           << "start=" << BWAPI::WalkPosition(position)
-                           << ";type=" << type
-                           << ";range=" << range
-                           << ";delta=" << delta
-                           << ";value=" << data[x * maxY + y];
-
-                Log::Debug() << "Negative grid value @ " << BWAPI::Position(x, y) << "\n"
-                             << "start=" << BWAPI::WalkPosition(position)
-                             << ";type=" << type
-                             << ";range=" << range
-                             << ";delta=" << delta
-                             << ";value=" << data[x * maxY + y];
+        // Values outside the range of the storage type wrap around to negative, so this also catches saturation
+        for (int y = yStart; y < yEnd; y++)
+        {
+            if (column[y] >= 0) continue;
+
+            Log::Get() << "Negative grid value @ " << BWAPI::Position(x, y) << "\n"
+                       << "start=" << BWAPI::WalkPosition(position)
+                       << ";type=" << type
+                       << ";range=" << range
+                       << ";delta=" << delta
+                       << ";value=" << column[y];
+
+            Log::Debug() << "Negative grid value @ " << BWAPI::Position(x, y) << "\n"
+                         << "start=" << BWAPI::WalkPosition(position)
+                         << ";type=" << type
+                         << ";range=" << range
+                         << ";delta=" << delta
+                         << ";value=" << column[y];
 
 #if ASSERT_NEGATIVE_VALUES
-                BWAPI::Broodwar->leaveGame();
-#endif
-            }
+            BWAPI::Broodwar->leaveGame();
 #endif
         }
+#endif
+    }
+
+    if (!pyramid.empty() && stampedMaxX >= 0)
+    {
+        dirtyMinX = std::min(dirtyMinX, minX);
+        dirtyMinY = std::min(dirtyMinY, minY);
+        dirtyMaxX = std::max(dirtyMaxX, stampedMaxX);
+        dirtyMaxY = std::max(dirtyMaxY, stampedMaxY);
+    }
+
+    if (!heatmap.empty() && stampedMaxX >= 0)
+    {
+        heatmapDirtyMinX = std::min(heatmapDirtyMinX, minX);
+        heatmapDirtyMinY = std::min(heatmapDirtyMinY, minY);
+        heatmapDirtyMaxX = std::max(heatmapDirtyMaxX, stampedMaxX);
+        heatmapDirtyMaxY = std::max(heatmapDirtyMaxY, stampedMaxY);
     }
 
     frameLastUpdated = currentFrame;
 }
 
-void Grid::dumpHeatmapIfChanged(const std::string &heatmapName, const GridData &data)
+template<typename T>
+void Grid::GridData<T>::updatePyramid() const
 {
-    if (data.frameLastDumped >= data.frameLastUpdated) return;
+    if (dirtyMaxX < 0) return;
+
+    int x1 = dirtyMinX, y1 = dirtyMinY, x2 = dirtyMaxX, y2 = dirtyMaxY;
+    dirtyMinX = dirtyMinY = INT_MAX;
+    dirtyMaxX = dirtyMaxY = -1;
+
+    // Recompute the cells of each level covering the dirty rectangle from the level below, starting with the walk tiles
+    for (size_t level = 0; level < pyramid.size(); level++)
+    {
+        auto &current = pyramid[level];
+        int childShift = (level == 0) ? 0 : pyramid[level - 1].shift;
+        int blockShift = current.shift - childShift;
+        int childWidth = (level == 0) ? maxX : pyramid[level - 1].width;
+        int childHeight = (level == 0) ? maxY : pyramid[level - 1].height;
 
-    // Transpose the vector
-    std::vector<long> heatmapData(data.maxX * data.maxY);
-    for (int x = 0; x < data.maxX; x++)
+        for (int cellX = x1 >> current.shift; cellX <= x2 >> current.shift; cellX++)
+        {
+            for (int cellY = y1 >> current.shift; cellY <= y2 >> current.shift; cellY++)
+            {
+                T cellMax = 0;
+                long cellSum = 0;
+                int childXEnd = std::min(childWidth, (cellX + 1) << blockShift);
+                int childYEnd = std::min(childHeight, (cellY + 1) << blockShift);
+                for (int childX = cellX << blockShift; childX < childXEnd; childX++)
+                {
+                    for (int childY = cellY << blockShift; childY < childYEnd; childY++)
+                    {
+                        if (level == 0)
+                        {
+                            T value = data[childX * maxY + childY];
+                            cellMax = std::max(cellMax, value);
+                            cellSum += value;
+                        }
+                        else
+                        {
+                            auto &child = pyramid[level - 1];
+                            cellMax = std::max(cellMax, child.max[childX * childHeight + childY]);
+                            cellSum += child.sum[childX * childHeight + childY];
+                        }
+                    }
+                }
+
+                current.max[cellX * current.height + cellY] = cellMax;
+                current.sum[cellX * current.height + cellY] = cellSum;
+            }
+        }
+    }
+}
+
+template<typename T>
+long Grid::GridData<T>::reduce(int level, int cellX, int cellY, int x1, int y1, int x2, int y2, bool sum) const
+{
+    // Level -1 is the walk tile data itself
+    if (level < 0) return data[cellX * maxY + cellY];
+
+    auto &current = pyramid[level];
+    int cellIndex = cellX * current.height + cellY;
+    if (current.max[cellIndex] == 0) return 0;
+
+    // Use the cell's aggregate if it is entirely inside the rectangle
+    int cellX1 = cellX << current.shift;
+    int cellY1 = cellY << current.shift;
+    int cellX2 = cellX1 + (1 << current.shift) - 1;
+    int cellY2 = cellY1 + (1 << current.shift) - 1;
+    if (cellX1 >= x1 && cellY1 >= y1 && cellX2 <= x2 && cellY2 <= y2)
+    {
+        return sum ? current.sum[cellIndex] : current.max[cellIndex];
+    }
+
+    // Otherwise combine the children that intersect the rectangle
+    int childShift = (level == 0) ? 0 : pyramid[level - 1].shift;
+    long result = 0;
+    for (int childX = std::max(cellX1, x1) >> childShift; childX <= std::min(cellX2, x2) >> childShift; childX++)
+    {
+        for (int childY = std::max(cellY1, y1) >> childShift; childY <= std::min(cellY2, y2) >> childShift; childY++)
+        {
+            long childResult = reduce(level - 1, childX, childY, x1, y1, x2, y2, sum);
+            result = sum ? (result + childResult) : std::max(result, childResult);
+        }
+    }
+
+    return result;
+}
+
+template<typename T>
+long Grid::GridData<T>::maxInRect(int x1, int y1, int x2, int y2) const
+{
+    updatePyramid();
+
+    x1 = std::max(0, x1);
+    y1 = std::max(0, y1);
+    x2 = std::min(maxX - 1, x2);
+    y2 = std::min(maxY - 1, y2);
+    if (x1 > x2 || y1 > y2) return 0;
+
+    int top = (int)pyramid.size() - 1;
+    int shift = (top < 0) ? 0 : pyramid[top].shift;
+    long result = 0;
+    for (int cellX = x1 >> shift; cellX <= x2 >> shift; cellX++)
     {
-        for (int y = 0; y < data.maxY; y++)
+        for (int cellY = y1 >> shift; cellY <= y2 >> shift; cellY++)
         {
-            heatmapData[x + y * data.maxX] = data.data[x * data.maxY + y];
+            result = std::max(result, reduce(top, cellX, cellY, x1, y1, x2, y2, false));
         }
     }
 
-    CherryVis::addHeatmap(heatmapName, heatmapData, data.maxX, data.maxY);
+    return result;
+}
 
+template<typename T>
+long Grid::GridData<T>::sumInRect(int x1, int y1, int x2, int y2) const
+{
+    updatePyramid();
+
+    x1 = std::max(0, x1);
+    y1 = std::max(0, y1);
+    x2 = std::min(maxX - 1, x2);
+    y2 = std::min(maxY - 1, y2);
+    if (x1 > x2 || y1 > y2) return 0;
+
+    int top = (int)pyramid.size() - 1;
+    int shift = (top < 0) ? 0 : pyramid[top].shift;
+    long result = 0;
+    for (int cellX = x1 >> shift; cellX <= x2 >> shift; cellX++)
+    {
+        for (int cellY = y1 >> shift; cellY <= y2 >> shift; cellY++)
+        {
+            result += reduce(top, cellX, cellY, x1, y1, x2, y2, true);
+        }
+    }
+
+    return result;
+}
+
+template<typename T>
+bool Grid::GridData<T>::anyAlong(int x1, int y1, int x2, int y2) const
+{
+    // Trace the segment between the walk tile centers
+    return anyAlongSegment(x1 + 0.5, y1 + 0.5, x2 + 0.5, y2 + 0.5);
+}
+
+template<typename T>
+bool Grid::GridData<T>::anyAlongSegment(double x1, double y1, double x2, double y2) const
+{
+    // If the bounding box is clear, so is the segment; otherwise split it until it is no longer than a walk tile
+    if (maxInRect((int)std::min(x1, x2), (int)std::min(y1, y2), (int)std::max(x1, x2), (int)std::max(y1, y2)) == 0) return false;
+    if (std::abs(x2 - x1) <= 1.0 && std::abs(y2 - y1) <= 1.0) return true;
+
+    double midX = (x1 + x2) / 2.0;
+    double midY = (y1 + y2) / 2.0;
+    return anyAlongSegment(x1, y1, midX, midY) || anyAlongSegment(midX, midY, x2, y2);
+}
+
+template<typename T>
+void Grid::dumpHeatmapIfChanged(const std::string &heatmapName, const GridData<T> &data)
+{
+    if (data.frameLastDumped >= data.frameLastUpdated) return;
     data.frameLastDumped = currentFrame;
+
+    // The first dump transposes the whole vector, later ones only the region stamped since the previous dump
+    bool changed = false;
+    int x1 = data.heatmapDirtyMinX, y1 = data.heatmapDirtyMinY, x2 = data.heatmapDirtyMaxX, y2 = data.heatmapDirtyMaxY;
+    if (data.heatmap.empty())
+    {
+        data.heatmap.resize(data.maxX * data.maxY);
+        x1 = y1 = 0;
+        x2 = data.maxX - 1;
+        y2 = data.maxY - 1;
+        changed = true;
+    }
+    data.heatmapDirtyMinX = data.heatmapDirtyMinY = INT_MAX;
+    data.heatmapDirtyMaxX = data.heatmapDirtyMaxY = -1;
+
+    for (int x = x1; x <= x2; x++)
+    {
+        for (int y = y1; y <= y2; y++)
+        {
+            long value = data.data[x * data.maxY + y];
+            if (data.heatmap[x + y * data.maxX] == value) continue;
+
+            data.heatmap[x + y * data.maxX] = value;
+            changed = true;
+        }
+    }
+
+    // Stamps that cancelled out since the previous dump leave the heatmap as it was
+    if (!changed) return;
+
+    CherryVis::addHeatmap(heatmapName, data.heatmap, data.maxX, data.maxY);
+}
+
+template struct Grid::GridData<int16_t>;
+template struct Grid::GridData<int32_t>;
+template void Grid::dumpHeatmapIfChanged(const std::string &heatmapName, const GridData<int16_t> &data);
+template void Grid::dumpHeatmapIfChanged(const std::string &heatmapName, const GridData<int32_t> &data);
+
+void Grid::beginBatch()
+{
+    batching = true;
+}
+
+void Grid::applyBatch()
+{
+    batching = false;
+    if (pendingStamps.empty()) return;
+
+    // Sort so stamps with the same footprint are adjacent, then apply the net delta of each footprint
+    // Positive deltas are applied first, as a cell only goes negative part-way through a batch if something is removed
+    // before what covers it is added, e.g. the sieged tank minimum range stamp
+    auto sameFootprint = [](const PendingStamp &a, const PendingStamp &b)
+    {
+        return a.layer == b.layer && a.type == b.type && a.range == b.range && a.position == b.position;
+    };
+    std::sort(pendingStamps.begin(), pendingStamps.end(), [](const PendingStamp &a, const PendingStamp &b)
+    {
+        return std::tie(a.layer, a.type, a.range, a.position.x, a.position.y)
+               < std::tie(b.layer, b.type, b.range, b.position.x, b.position.y);
+    });
+
+    size_t netCount = 0;
+    for (size_t i = 0; i < pendingStamps.size();)
+    {
+        auto &stamp = pendingStamps[i];
+        int delta = 0;
+        for (; i < pendingStamps.size() && sameFootprint(stamp, pendingStamps[i]); i++)
+        {
+            delta += pendingStamps[i].delta;
+        }
+        if (delta == 0) continue;
+
+        auto &net = pendingStamps[netCount++];
+        net = stamp;
+        net.delta = delta;
+    }
+    pendingStamps.resize(netCount);
+
+    std::stable_partition(pendingStamps.begin(), pendingStamps.end(), [](const PendingStamp &stamp)
+    {
+        return stamp.delta > 0;
+    });
+    for (auto &stamp : pendingStamps)
+    {
+        add(stamp.layer, stamp.type, stamp.range, BWAPI::Position(stamp.position), stamp.delta);
+    }
+
+    pendingStamps.clear();
+}
+
+void Grid::add(Layer layer, BWAPI::UnitType type, int range, BWAPI::Position position, int delta)
+{
+    if (batching)
+    {
+        pendingStamps.push_back({layer, type, range, BWAPI::WalkPosition(position), delta});
+        return;
+    }
+
+    switch (layer)
+    {
+        case Layer::Collision:
+            _collision.add(type, range, position, delta);
+            break;
+        case Layer::GroundThreat:
+            _groundThreat.add(type, range, position, delta);
+            break;
+        case Layer::StaticGroundThreat:
+            _staticGroundThreat.add(type, range, position, delta);
+            break;
+        case Layer::AirThreat:
+            _airThreat.add(type, range, position, delta);
+            break;
+        case Layer::Detection:
+            _detection.add(type, range, position, delta);
+            break;
+        case Layer::StasisRange:
+            _stasisRange.add(type, range, position, delta);
+            break;
+    }
 }
 
 void Grid::unitCreated(BWAPI::UnitType type, BWAPI::Position position, bool completed, bool burrowed, bool immobile)
 {
-    if (!type.isFlyer() && !burrowed) _collision.add(type, 0, position, 1);
+    if (!type.isFlyer() && !burrowed) add(Layer::Collision, type, 0, position, 1);
     if (!immobile && (type == BWAPI::UnitTypes::Terran_Siege_Tank_Siege_Mode ||
         type == BWAPI::UnitTypes::Terran_Siege_Tank_Tank_Mode))
     {
-        _stasisRange.add(type, STASIS_RANGE, position, 1);
+        add(Layer::StasisRange, type, STASIS_RANGE, position, 1);
     }
     if (completed) unitCompleted(type, position, burrowed, immobile);
 }
@@ -112,7 +441,7 @@ void Grid::unitCompleted(BWAPI::UnitType type, BWAPI::Position position, bool bu
     if (weaponUnitType.groundWeapon() != BWAPI::WeaponTypes::None && !immobile &&
         ((burrowed && type == BWAPI::UnitTypes::Zerg_Lurker) || (!burrowed && type != BWAPI::UnitTypes::Zerg_Lurker)))
     {
-        _groundThreat.add(
+        add(Layer::GroundThreat,
                 type,
                 upgradeTracker->weaponRange(weaponUnitType.groundWeapon()) + rangeBuffer + (type == BWAPI::UnitTypes::Terran_Bunker ? 48 : 0),
                 position,
@@ -121,7 +450,7 @@ void Grid::unitCompleted(BWAPI::UnitType type, BWAPI::Position position, bool bu
 
         if (UnitUtil::IsStationaryAttacker(type))
         {
-            _staticGroundThreat.add(
+            add(Layer::StaticGroundThreat,
                     type,
                     upgradeTracker->weaponRange(weaponUnitType.groundWeapon()) + rangeBuffer + (type == BWAPI::UnitTypes::Terran_Bunker ? 48 : 0),
                     position,
@@ -132,13 +461,13 @@ void Grid::unitCompleted(BWAPI::UnitType type, BWAPI::Position position, bool bu
         // For sieged tanks, subtract the area close to the tank
         if (weaponUnitType.groundWeapon().minRange() > 0)
         {
-            _groundThreat.add(
+            add(Layer::GroundThreat,
                     type,
                     weaponUnitType.groundWeapon().minRange() - rangeBuffer,
                     position,
                     -upgradeTracker->weaponDamage(weaponUnitType.groundWeapon()) * weaponUnitType.maxGroundHits());
 
-            _staticGroundThreat.add(
+            add(Layer::StaticGroundThreat,
                     type,
                     weaponUnitType.groundWeapon().minRange() - rangeBuffer,
                     position,
@@ -148,7 +477,7 @@ void Grid::unitCompleted(BWAPI::UnitType type, BWAPI::Position position, bool bu
 
     if (weaponUnitType.airWeapon() != BWAPI::WeaponTypes::None && !immobile && !burrowed)
     {
-        _airThreat.add(
+        add(Layer::AirThreat,
                 type,
                 upgradeTracker->weaponRange(weaponUnitType.airWeapon()) + rangeBuffer + (type == BWAPI::UnitTypes::Terran_Bunker ? 48 : 0),
                 position,
@@ -160,11 +489,11 @@ void Grid::unitCompleted(BWAPI::UnitType type, BWAPI::Position position, bool bu
     {
         if (type.isBuilding())
         {
-            _detection.add(type, 7 * 32 + rangeBuffer, position, 1);
+            add(Layer::Detection, type, 7 * 32 + rangeBuffer, position, 1);
         }
         else
         {
-            _detection.add(type, upgradeTracker->unitSightRange(type) + rangeBuffer, position, 1);
+            add(Layer::Detection, type, upgradeTracker->unitSightRange(type) + rangeBuffer, position, 1);
         }
     }
 }
@@ -188,11 +517,11 @@ void Grid::unitMoved(BWAPI::UnitType type,
 
 void Grid::unitDestroyed(BWAPI::UnitType type, BWAPI::Position position, bool completed, bool burrowed, bool immobile)
 {
-    if (!type.isFlyer() && !burrowed) _collision.add(type, 0, position, -1);
+    if (!type.isFlyer() && !burrowed) add(Layer::Collision, type, 0, position, -1);
     if (!immobile && (type == BWAPI::UnitTypes::Terran_Siege_Tank_Siege_Mode ||
         type == BWAPI::UnitTypes::Terran_Siege_Tank_Tank_Mode))
     {
-        _stasisRange.add(type, STASIS_RANGE, position, -1);
+        add(Layer::StasisRange, type, STASIS_RANGE, position, -1);
     }
 
     // If the unit was a building that was destroyed or cancelled before being completed, we only
@@ -211,20 +540,20 @@ void Grid::unitDestroyed(BWAPI::UnitType type, BWAPI::Position position, bool co
         // We need to do it in this order to avoid triggering the negative values check
         if (weaponUnitType.groundWeapon().minRange() > 0)
         {
-            _groundThreat.add(
+            add(Layer::GroundThreat,
                     type,
                     weaponUnitType.groundWeapon().minRange() - rangeBuffer,
                     position,
                     upgradeTracker->weaponDamage(weaponUnitType.groundWeapon()) * weaponUnitType.maxGroundHits());
 
-            _staticGroundThreat.add(
+            add(Layer::StaticGroundThreat,
                     type,
                     weaponUnitType.groundWeapon().minRange() - rangeBuffer,
                     position,
                     upgradeTracker->weaponDamage(weaponUnitType.groundWeapon()) * weaponUnitType.maxGroundHits());
         }
 
-        _groundThreat.add(
+        add(Layer::GroundThreat,
                 type,
                 upgradeTracker->weaponRange(weaponUnitType.groundWeapon()) + rangeBuffer + (type == BWAPI::UnitTypes::Terran_Bunker ? 48 : 0),
                 position,
@@ -233,7 +562,7 @@ void Grid::unitDestroyed(BWAPI::UnitType type, BWAPI::Position position, bool co
 
         if (UnitUtil::IsStationaryAttacker(type))
         {
-            _staticGroundThreat.add(
+            add(Layer::StaticGroundThreat,
                     type,
                     upgradeTracker->weaponRange(weaponUnitType.groundWeapon()) + rangeBuffer + (type == BWAPI::UnitTypes::Terran_Bunker ? 48 : 0),
                     position,
@@ -244,7 +573,7 @@ void Grid::unitDestroyed(BWAPI::UnitType type, BWAPI::Position position, bool co
 
     if (weaponUnitType.airWeapon() != BWAPI::WeaponTypes::None && !immobile && !burrowed)
     {
-        _airThreat.add(
+        add(Layer::AirThreat,
                 type,
                 upgradeTracker->weaponRange(weaponUnitType.airWeapon()) + rangeBuffer + (type == BWAPI::UnitTypes::Terran_Bunker ? 48 : 0),
                 position,
@@ -256,11 +585,11 @@ void Grid::unitDestroyed(BWAPI::UnitType type, BWAPI::Position position, bool co
     {
         if (type.isBuilding())
         {
-            _detection.add(type, 7 * 32 + rangeBuffer, position, -1);
+            add(Layer::Detection, type, 7 * 32 + rangeBuffer, position, -1);
         }
         else
         {
-            _detection.add(type, upgradeTracker->unitSightRange(type) + rangeBuffer, position, -1);
+            add(Layer::Detection, type, upgradeTracker->unitSightRange(type) + rangeBuffer, position, -1);
         }
     }
 }
@@ -274,7 +603,7 @@ void Grid::unitWeaponDamageUpgraded(BWAPI::UnitType type, BWAPI::Position positi
 
     if (weapon.targetsGround())
     {
-        _groundThreat.add(
+        add(Layer::GroundThreat,
                 type,
                 upgradeTracker->weaponRange(weapon) + rangeBuffer + (type == BWAPI::UnitTypes::Terran_Bunker ? 48 : 0),
                 position,
@@ -282,17 +611,33 @@ void Grid::unitWeaponDamageUpgraded(BWAPI::UnitType type, BWAPI::Position positi
 
         if (UnitUtil::IsStationaryAttacker(type))
         {
-            _staticGroundThreat.add(
+            add(Layer::StaticGroundThreat,
                     type,
                     upgradeTracker->weaponRange(weapon) + rangeBuffer + (type == BWAPI::UnitTypes::Terran_Bunker ? 48 : 0),
                     position,
                     (newDamage - formerDamage) * weaponUnitType.maxGroundHits() * (type == BWAPI::UnitTypes::Terran_Bunker ? 4 : 1));
         }
+
+        // For sieged tanks, the area close to the tank must stay at zero
+        if (weapon.minRange() > 0)
+        {
+            add(Layer::GroundThreat,
+                    type,
+                    weapon.minRange() - rangeBuffer,
+                    position,
+                    -(newDamage - formerDamage) * weaponUnitType.maxGroundHits());
+
+            add(Layer::StaticGroundThreat,
+                    type,
+                    weapon.minRange() - rangeBuffer,
+                    position,
+                    -(newDamage - formerDamage) * weaponUnitType.maxGroundHits());
+        }
     }
 
     if (weapon.targetsAir())
     {
-        _airThreat.add(
+        add(Layer::AirThreat,
                 type,
                 upgradeTracker->weaponRange(weapon) + rangeBuffer + (type == BWAPI::UnitTypes::Terran_Bunker ? 48 : 0),
                 position,
@@ -307,14 +652,14 @@ void Grid::unitWeaponRangeUpgraded(BWAPI::UnitType type, BWAPI::Position positio
 
     if (weapon.targetsGround())
     {
-        _groundThreat.add(
+        add(Layer::GroundThreat,
                 type,
                 formerRange + rangeBuffer + (type == BWAPI::UnitTypes::Terran_Bunker ? 48 : 0),
                 position,
                 -upgradeTracker->weaponDamage(weapon) * type.maxGroundHits()
                 * (type == BWAPI::UnitTypes::Terran_Bunker ? 4 : 1));
 
-        _groundThreat.add(
+        add(Layer::GroundThreat,
                 type,
                 newRange + rangeBuffer + (type == BWAPI::UnitTypes::Terran_Bunker ? 48 : 0),
                 position,
@@ -323,14 +668,14 @@ void Grid::unitWeaponRangeUpgraded(BWAPI::UnitType type, BWAPI::Position positio
 
         if (UnitUtil::IsStationaryAttacker(type))
         {
-            _staticGroundThreat.add(
+            add(Layer::StaticGroundThreat,
                     type,
                     formerRange + rangeBuffer + (type == BWAPI::UnitTypes::Terran_Bunker ? 48 : 0),
                     position,
                     -upgradeTracker->weaponDamage(weapon) * type.maxGroundHits()
                     * (type == BWAPI::UnitTypes::Terran_Bunker ? 4 : 1));
 
-            _staticGroundThreat.add(
+            add(Layer::StaticGroundThreat,
                     type,
                     newRange + rangeBuffer + (type == BWAPI::UnitTypes::Terran_Bunker ? 48 : 0),
                     position,
@@ -341,14 +686,14 @@ void Grid::unitWeaponRangeUpgraded(BWAPI::UnitType type, BWAPI::Position positio
 
     if (weapon.targetsAir())
     {
-        _airThreat.add(
+        add(Layer::AirThreat,
                 type,
                 formerRange + rangeBuffer + (type == BWAPI::UnitTypes::Terran_Bunker ? 48 : 0),
                 position,
                 -upgradeTracker->weaponDamage(weapon) * type.maxAirHits()
                 * (type == BWAPI::UnitTypes::Terran_Bunker ? 4 : 1));
 
-        _airThreat.add(
+        add(Layer::AirThreat,
                 type,
                 newRange + rangeBuffer + (type == BWAPI::UnitTypes::Terran_Bunker ? 48 : 0),
                 position,
@@ -362,6 +707,6 @@ void Grid::unitSightRangeUpgraded(BWAPI::UnitType type, BWAPI::Position position
     // Only mobile detectors are handled here
     if (!type.isDetector() || type.isBuilding()) return;
 
-    _detection.add(type, formerRange + rangeBuffer, position, -1);
-    _detection.add(type, newRange + rangeBuffer, position, 1);
+    add(Layer::Detection, type, formerRange + rangeBuffer, position, -1);
+    add(Layer::Detection, type, newRange + rangeBuffer, position, 1);
 }
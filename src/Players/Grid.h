@@ -11,24 +11,71 @@ public:
     Grid (const Grid&) = delete;
     Grid &operator=(const Grid&) = delete;
 
+    // Layers are stored column-major, so a unit's footprint is stamped as one contiguous run per column
+    // Threat layers hold summed weapon damage, so need 32 bits; the other layers count units and fit in 16 bits
+    template<typename T>
     struct GridData
     {
         GridData (const GridData&) = delete;
         GridData &operator=(const GridData&) = delete;
 
-        std::vector<long> data;
+        // Max and sum of a block of cells from the level below, used to answer region queries without scanning every walk tile
+        struct PyramidLevel
+        {
+            int shift;  // Block size in walk tiles is 1 << shift
+            int width;
+            int height;
+            std::vector<T> max;
+            std::vector<long> sum;
+        };
+
+        std::vector<T> data;
 
         int maxX;
         int maxY;
 
+        // Tile, 4x4-tile and 16x16-tile levels; empty for layers that are not queried over regions
+        // Stamps only grow the dirty rectangle, and the pyramid is brought up-to-date by the next region query
+        mutable std::vector<PyramidLevel> pyramid;
+        mutable int dirtyMinX;
+        mutable int dirtyMinY;
+        mutable int dirtyMaxX;
+        mutable int dirtyMaxY;
+
         int frameLastUpdated;
         mutable int frameLastDumped;
 
-        GridData() : frameLastUpdated(-1), frameLastDumped(-1)
+        // The transposed data of the last heatmap dump, and the rectangle stamped since then
+        // Only the stamped rectangle is transposed again, and a dump is skipped if it has not changed
+        mutable std::vector<long> heatmap;
+        mutable int heatmapDirtyMinX;
+        mutable int heatmapDirtyMinY;
+        mutable int heatmapDirtyMaxX;
+        mutable int heatmapDirtyMaxY;
+
+        explicit GridData(bool withPyramid = false)
+                : dirtyMinX(INT_MAX)
+                , dirtyMinY(INT_MAX)
+                , dirtyMaxX(-1)
+                , dirtyMaxY(-1)
+                , frameLastUpdated(-1)
+                , frameLastDumped(-1)
+                , heatmapDirtyMinX(INT_MAX)
+                , heatmapDirtyMinY(INT_MAX)
+                , heatmapDirtyMaxX(-1)
+                , heatmapDirtyMaxY(-1)
         {
             maxX = BWAPI::Broodwar->mapWidth() * 4;
             maxY = BWAPI::Broodwar->mapHeight() * 4;
             data.assign(maxX * maxY, 0);
+
+            if (!withPyramid) return;
+            for (int shift = 2; shift <= 6; shift += 2)
+            {
+                int width = (maxX + (1 << shift) - 1) >> shift;
+                int height = (maxY + (1 << shift) - 1) >> shift;
+                pyramid.push_back({shift, width, height, std::vector<T>(width * height, 0), std::vector<long>(width * height, 0)});
+            }
         }
 
         long operator[](BWAPI::Position pos) const
@@ -47,11 +94,35 @@ public:
         }
 
         void add(BWAPI::UnitType type, int range, BWAPI::Position position, int delta);
+
+        // Region queries take inclusive walk tile coordinates, which are clipped to the map
+        long maxInRect(int x1, int y1, int x2, int y2) const;
+
+        long sumInRect(int x1, int y1, int x2, int y2) const;
+
+        bool anyAlong(int x1, int y1, int x2, int y2) const;
+
+    private:
+        void updatePyramid() const;
+
+        long reduce(int level, int cellX, int cellY, int x1, int y1, int x2, int y2, bool sum) const;
+
+        bool anyAlongSegment(double x1, double y1, double x2, double y2) const;
     };
 
     explicit Grid(std::shared_ptr<UpgradeTracker> upgradeTracker, BWAPI::Player player)
         : upgradeTracker(std::move(upgradeTracker))
-        , rangeBuffer(player == BWAPI::Broodwar->self() ? -16 : 48) {}
+        , rangeBuffer(player == BWAPI::Broodwar->self() ? -16 : 48)
+        , batching(false)
+        , _groundThreat(true)
+        , _airThreat(true)
+        , _detection(true) {}
+
+    // While a batch is active, stamps are buffered instead of applied to the layers.
+    // applyBatch coalesces the buffered stamps, so e.g. a unit that moves away and back in the same batch causes no writes.
+    void beginBatch();
+
+    void applyBatch();
 
     void unitCreated(BWAPI::UnitType type, BWAPI::Position position, bool completed, bool burrowed, bool immobile);
 
@@ -110,6 +181,43 @@ public:
 
     long stasisRange(int walkX, int walkY) const { return _stasisRange.at(walkX, walkY); };
 
+    // Region queries over the threat and detection layers, answered from the pyramids
+    // Rectangles are given by their inclusive top-left and bottom-right positions
+    long maxGroundThreatInRect(BWAPI::Position topLeft, BWAPI::Position bottomRight) const
+    {
+        return _groundThreat.maxInRect(topLeft.x >> 3U, topLeft.y >> 3U, bottomRight.x >> 3U, bottomRight.y >> 3U);
+    };
+
+    long maxAirThreatInRect(BWAPI::Position topLeft, BWAPI::Position bottomRight) const
+    {
+        return _airThreat.maxInRect(topLeft.x >> 3U, topLeft.y >> 3U, bottomRight.x >> 3U, bottomRight.y >> 3U);
+    };
+
+    long sumGroundThreatInRect(BWAPI::Position topLeft, BWAPI::Position bottomRight) const
+    {
+        return _groundThreat.sumInRect(topLeft.x >> 3U, topLeft.y >> 3U, bottomRight.x >> 3U, bottomRight.y >> 3U);
+    };
+
+    long sumAirThreatInRect(BWAPI::Position topLeft, BWAPI::Position bottomRight) const
+    {
+        return _airThreat.sumInRect(topLeft.x >> 3U, topLeft.y >> 3U, bottomRight.x >> 3U, bottomRight.y >> 3U);
+    };
+
+    bool anyGroundThreatAlong(BWAPI::Position start, BWAPI::Position end) const
+    {
+        return _groundThreat.anyAlong(start.x >> 3U, start.y >> 3U, end.x >> 3U, end.y >> 3U);
+    };
+
+    bool anyAirThreatAlong(BWAPI::Position start, BWAPI::Position end) const
+    {
+        return _airThreat.anyAlong(start.x >> 3U, start.y >> 3U, end.x >> 3U, end.y >> 3U);
+    };
+
+    bool anyDetectionAlong(BWAPI::Position start, BWAPI::Position end) const
+    {
+        return _detection.anyAlong(start.x >> 3U, start.y >> 3U, end.x >> 3U, end.y >> 3U);
+    };
+
     void dumpCollisionHeatmapIfChanged(const std::string &heatmapName) const { dumpHeatmapIfChanged(heatmapName, _collision); };
 
     void dumpGroundThreatHeatmapIfChanged(const std::string &heatmapName) const { dumpHeatmapIfChanged(heatmapName, _groundThreat); };
@@ -123,15 +231,40 @@ public:
     void dumpStasisRangeHeatmapIfChanged(const std::string &heatmapName) const { dumpHeatmapIfChanged(heatmapName, _stasisRange); };
 
 private:
+    enum class Layer
+    {
+        Collision,
+        GroundThreat,
+        StaticGroundThreat,
+        AirThreat,
+        Detection,
+        StasisRange
+    };
+
+    struct PendingStamp
+    {
+        Layer layer;
+        BWAPI::UnitType type;
+        int range;
+        BWAPI::WalkPosition position;
+        int delta;
+    };
+
     std::shared_ptr<UpgradeTracker> upgradeTracker;
     int rangeBuffer;
 
-    GridData _collision;
-    GridData _groundThreat;
-    GridData _staticGroundThreat;
-    GridData _airThreat;
-    GridData _detection;
-    GridData _stasisRange;
+    bool batching;
+    std::vector<PendingStamp> pendingStamps;
+
+    GridData<int16_t> _collision;
+    GridData<int32_t> _groundThreat;
+    GridData<int32_t> _staticGroundThreat;
+    GridData<int32_t> _airThreat;
+    GridData<int16_t> _detection;
+    GridData<int16_t> _stasisRange;
+
+    void add(Layer layer, BWAPI::UnitType type, int range, BWAPI::Position position, int delta);
 
-    static void dumpHeatmapIfChanged(const std::string &heatmapName, const GridData &data);
+    template<typename T>
+    static void dumpHeatmapIfChanged(const std::string &heatmapName, const GridData<T> &data);
 };
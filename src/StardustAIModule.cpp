@@ -1,8 +1,10 @@
 #include "StardustAIModule.h"
 
 #include "Timer.h"
+#include "AsyncWriter.h"
 #include "Map.h"
 #include "NoGoAreas.h"
+#include "MapDataCache.h"
 #include "PathFinding.h"
 #include "Producer.h"
 #include "Builder.h"
@@ -16,6 +18,7 @@
 #include "Bullets.h"
 #include "Players.h"
 #include "Geo.h"
+#include "FrameScheduler.h"
 
 int currentFrame;
 
@@ -69,6 +72,9 @@ void StardustAIModule::onStart()
     gameFinished = false;
     currentFrame = 0;
 
+    // Start the instrumentation writer thread first, as everything else may log
+    AsyncWriter::start();
+
     // Initialize globals that just need to make sure their global data is reset
     Log::initialize();
     Builder::initialize();
@@ -79,6 +85,8 @@ void StardustAIModule::onStart()
     Bullets::initialize();
     Players::initialize();
     Geo::initialize();
+    Timer::initialize();
+    FrameScheduler::initialize();
     PathFinding::clearGrids();
     PathFinding::initializeSearch();
 
@@ -141,6 +149,14 @@ void StardustAIModule::onEnd(bool isWinner)
 
     Opponent::gameEnd(isWinner);
     WorkerOrderTimer::write();
+    MapDataCache::write();
+    Timer::writeSummary();
+    FrameScheduler::writeSummary();
+
+    // Runs all queued instrumentation output; anything written after this is written synchronously
+    AsyncWriter::stop();
+
+    // Builds the trace index from the data file parts the writer thread created, so must come after stopping it
     CherryVis::gameEnd();
 }
 
@@ -166,6 +182,7 @@ void StardustAIModule::onFrame()
 #endif
 
     Timer::start("Frame");
+    FrameScheduler::frameStart();
 
     // Before doing anything else, check if the opponent has left or been eliminated
     for (auto &event : BWAPI::Broodwar->getEvents())
@@ -224,7 +241,8 @@ void StardustAIModule::onFrame()
     General::updateClusters();
     Timer::checkpoint("General::updateClusters");
 
-    BuildingPlacement::update();
+    // Build locations are planned ahead, so it is fine if they are a few frames stale on slow frames
+    FrameScheduler::run("BuildingPlacement::update", 4, BuildingPlacement::update);
     Timer::checkpoint("BuildingPlacement::update");
 
     Builder::update();
@@ -329,9 +347,13 @@ void StardustAIModule::onFrame()
     }
 
     // Instrumentation
-    NoGoAreas::writeInstrumentation();
-    General::writeInstrumentation();
-    WorkerOrderTimer::writeInstrumentation();
+    FrameScheduler::run("Instrumentation", 24, []()
+    {
+        NoGoAreas::writeInstrumentation();
+        General::writeInstrumentation();
+        CombatSim::writeInstrumentation();
+        WorkerOrderTimer::writeInstrumentation();
+    });
 
 #if COLLISION_HEATMAP_FREQUENCY_ENEMY
     if (currentFrame % COLLISION_HEATMAP_FREQUENCY_ENEMY == 0)
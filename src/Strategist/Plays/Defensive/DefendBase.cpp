@@ -127,7 +127,7 @@ void DefendBase::update()
         // Take all units that are very close to the base
         auto gridNodePredicate = [](const NavigationGrid::GridNode &gridNode)
         {
-            return gridNode.cost < 1200;
+            return gridNode.cost() < 1200;
         };
         status.unitRequirements.emplace_back(requestedUnits,
                                              BWAPI::UnitTypes::Protoss_Zealot,
@@ -162,7 +162,7 @@ void DefendBase::update()
         // Only reserve units that have a safe path to the base
         auto gridNodePredicate = [](const NavigationGrid::GridNode &gridNode)
         {
-            return gridNode.cost < 1200 || Players::grid(BWAPI::Broodwar->enemy()).groundThreat(gridNode.center()) == 0;
+            return gridNode.cost() < 1200 || Players::grid(BWAPI::Broodwar->enemy()).groundThreat(gridNode.center()) == 0;
         };
 
         status.unitRequirements.emplace_back(requestedUnits,
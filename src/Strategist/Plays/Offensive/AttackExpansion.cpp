@@ -77,7 +77,7 @@ void AttackExpansion::update()
         // Prefer units that have a safe path to the base
         auto gridNodePredicate = [](const NavigationGrid::GridNode &gridNode)
         {
-            return gridNode.cost < 1200 || Players::grid(BWAPI::Broodwar->enemy()).groundThreat(gridNode.center()) == 0;
+            return gridNode.cost() < 1200 || Players::grid(BWAPI::Broodwar->enemy()).groundThreat(gridNode.center()) == 0;
         };
         status.unitRequirements.emplace_back(requestedUnits,
                                              BWAPI::UnitTypes::Protoss_Dragoon,
@@ -145,7 +145,7 @@ namespace
         auto grid = PathFinding::getNavigationGrid(scout.targetBase->getPosition());
         if (!grid) return false;
         auto node = (*grid)[scout.unit->lastPosition];
-        if (node.cost == USHRT_MAX)
+        if (node.cost() == USHRT_MAX)
         {
             // This means either that our scout is in an unexpected position or the enemy has done a wall-in
             // Check for the latter by checking if there is a path from the target base to our main
@@ -153,7 +153,7 @@ namespace
             if (!mainGrid) return false;
 
             auto targetNode = (*mainGrid)[scout.targetBase->getTilePosition()];
-            if (targetNode.cost == USHRT_MAX)
+            if (targetNode.cost() == USHRT_MAX)
             {
                 Map::setEnemyStartingMain(scout.targetBase);
                 return true;
@@ -164,18 +164,18 @@ namespace
 
         // Decreasing distance is fine
         // Increasing distance is fine if it jumps quite a bit - this generally means we've scouted a building that changes the path
-        if (node.cost<scout.closestDistanceToTargetBase || node.cost>(scout.lastDistanceToTargetBase + 100))
+        if (node.cost() < scout.closestDistanceToTargetBase || node.cost() > (scout.lastDistanceToTargetBase + 100))
         {
-            scout.closestDistanceToTargetBase = node.cost;
-            scout.lastDistanceToTargetBase = node.cost;
+            scout.closestDistanceToTargetBase = node.cost();
+            scout.lastDistanceToTargetBase = node.cost();
             scout.lastForwardMotionFrame = currentFrame;
             return false;
         }
 
-        scout.lastDistanceToTargetBase = node.cost;
+        scout.lastDistanceToTargetBase = node.cost();
 
         // Non-decreasing distance is fine if we are still far away from the enemy base
-        if (node.cost > 3000) return false;
+        if (node.cost() > 3000) return false;
 
         // Consider us to be blocked if we haven't made forward progress in five seconds
         if ((currentFrame - scout.lastForwardMotionFrame) > 120)
@@ -734,9 +734,9 @@ void EarlyGameWorkerScout::scoutEnemyBase()
         }
 
         auto navigationGrid = PathFinding::getNavigationGrid(scout.targetBase->getPosition());
-        auto node = navigationGrid ? &(*navigationGrid)[scout.unit->getTilePosition()] : nullptr;
-        node = node ? node->nextNode : nullptr;
-        node = node ? node->nextNode : nullptr;
+        auto node = navigationGrid ? (*navigationGrid)[scout.unit->getTilePosition()] : NavigationGrid::GridNode();
+        node = node ? node.nextNode() : node;
+        node = node ? node.nextNode() : node;
         if (!node)
         {
 #if DEBUG_UNIT_ORDERS
@@ -747,7 +747,7 @@ void EarlyGameWorkerScout::scoutEnemyBase()
             return;
         }
 
-        targetPos = node->center();
+        targetPos = node.center();
     }
     else
     {
@@ -165,16 +165,16 @@ namespace
         auto navigationGrid = PathFinding::getNavigationGrid(base->getPosition());
         if (navigationGrid)
         {
-            auto &node = (*navigationGrid)[unit->getTilePosition()];
-            auto nextNode = node.nextNode;
-            auto secondNode = nextNode ? nextNode->nextNode : nullptr;
+            auto node = (*navigationGrid)[unit->getTilePosition()];
+            auto nextNode = node.nextNode();
+            auto secondNode = nextNode ? nextNode.nextNode() : NavigationGrid::GridNode();
             auto blockingPredicate = [&](const Unit &enemy)
             {
                 // Consider it to be blocking if the unit is on one of the next two path nodes
                 auto tilePosition = enemy->getTilePosition();
-                if ((tilePosition.x == node.x && tilePosition.y == node.y) ||
-                    (nextNode && (tilePosition.x == nextNode->x && tilePosition.y == nextNode->y)) ||
-                    (secondNode && (tilePosition.x == secondNode->x && tilePosition.y == secondNode->y)))
+                if (tilePosition == node.tile() ||
+                    (nextNode && tilePosition == nextNode.tile()) ||
+                    (secondNode && tilePosition == secondNode.tile()))
                 {
                     return true;
                 }
@@ -182,7 +182,7 @@ namespace
                 // Consider it blocking if we are in a narrow choke, the enemy is in our attack range, and the enemy is closer to the goal
                 return Map::isInNarrowChoke(unit->getTilePosition())
                        && unit->isInOurWeaponRange(enemy)
-                       && (*navigationGrid)[enemy->getTilePosition()].cost <= node.cost;
+                       && (*navigationGrid)[enemy->getTilePosition()].cost() <= node.cost();
             };
             auto target = getTarget(unit, Units::allEnemy(), false, 100, blockingPredicate);
             if (target)
@@ -6,6 +6,7 @@
 #include "Opponent.h"
 #include "Map.h"
 #include "UnitUtil.h"
+#include "Timer.h"
 
 #include "OpponentEconomicModel.h"
 
@@ -438,7 +439,10 @@ namespace Strategist
 
     void update()
     {
-        OpponentEconomicModel::update();
+        {
+            Timer::Zone zone("Strategist::OpponentEconomicModel");
+            OpponentEconomicModel::update();
+        }
 
         // Change the strategy engine when we discover the race of a random opponent
         if (Opponent::hasRaceJustBeenDetermined())
@@ -469,16 +473,22 @@ namespace Strategist
 
         // Update the plays
         // They signal interesting changes to the Strategist through their PlayStatus object.
-        for (auto &play : plays)
         {
-            play->status.unitRequirements.clear();
-            play->status.removedUnits.clear();
-            play->assignedIncompleteUnits.clear();
-            play->update();
+            Timer::Zone zone("Strategist::updatePlays");
+            for (auto &play : plays)
+            {
+                play->status.unitRequirements.clear();
+                play->status.removedUnits.clear();
+                play->assignedIncompleteUnits.clear();
+                play->update();
+            }
         }
 
         // Allow the strategy engine to change our plays
-        engine->updatePlays(plays);
+        {
+            Timer::Zone zone("Strategist::engineUpdatePlays");
+            engine->updatePlays(plays);
+        }
 
         // Process the changes signalled by the PlayStatus objects
         for (auto it = plays.begin(); it != plays.end();)
@@ -534,7 +544,10 @@ namespace Strategist
             }
         }
 
-        updateUnitAssignments();
+        {
+            Timer::Zone zone("Strategist::updateUnitAssignments");
+            updateUnitAssignments();
+        }
 
         // Ask all of the plays for their mineral reservations
         // We are not prioritizing them right now, as the expectation is that not many plays will need mineral reservations, but this can be
@@ -553,7 +566,10 @@ namespace Strategist
         }
 
         // Feed everything through the strategy engine
-        engine->updateProduction(plays, prioritizedProductionGoals, mineralReservations);
+        {
+            Timer::Zone zone("Strategist::engineUpdateProduction");
+            engine->updateProduction(plays, prioritizedProductionGoals, mineralReservations);
+        }
 
         // Flatten the production goals into a vector ordered by priority
         productionGoals.clear();
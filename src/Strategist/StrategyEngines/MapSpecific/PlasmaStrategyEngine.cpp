@@ -9,6 +9,7 @@
 #include "Builder.h"
 #include "Opponent.h"
 #include "Units.h"
+#include "FrameScheduler.h"
 
 namespace
 {
@@ -26,7 +27,12 @@ void PlasmaStrategyEngine::initialize(std::vector<std::shared_ptr<Play>> &plays,
 
 void PlasmaStrategyEngine::updatePlays(std::vector<std::shared_ptr<Play>> &plays)
 {
-    auto newEnemyStrategy = recognizeEnemyStrategy();
+    // Strategy recognition only changes the result over several frames, so we allow it to be deferred on slow frames
+    auto newEnemyStrategy = enemyStrategy;
+    FrameScheduler::run("PlasmaStrategyEngine::recognizeEnemyStrategy", 12, [&]()
+    {
+        newEnemyStrategy = recognizeEnemyStrategy();
+    });
 
     if (enemyStrategy != newEnemyStrategy)
     {
@@ -1,6 +1,7 @@
 #include "StrategyEngines/PvP.h"
 
 #include "Units.h"
+#include "FrameScheduler.h"
 #include "Map.h"
 #include "Builder.h"
 #include "UnitUtil.h"
@@ -98,7 +99,12 @@ void PvP::updatePlays(std::vector<std::shared_ptr<Play>> &plays)
                 (std::ostringstream() << "[" << dragoons.first << "," << dragoons.second << "]").str());
     }
 
-    auto newEnemyStrategy = recognizeEnemyStrategy();
+    // Strategy recognition only changes the result over several frames, so we allow it to be deferred on slow frames
+    auto newEnemyStrategy = enemyStrategy;
+    FrameScheduler::run("PvP::recognizeEnemyStrategy", 12, [&]()
+    {
+        newEnemyStrategy = recognizeEnemyStrategy();
+    });
     auto newStrategy = chooseOurStrategy(newEnemyStrategy, plays);
 
     if (enemyStrategy != newEnemyStrategy)
@@ -1,6 +1,7 @@
 #include "StrategyEngines/PvT.h"
 
 #include "Units.h"
+#include "FrameScheduler.h"
 #include "Map.h"
 #include "UnitUtil.h"
 #include "Players.h"
@@ -71,7 +72,12 @@ void PvT::initialize(std::vector<std::shared_ptr<Play>> &plays, bool transitioni
 
 void PvT::updatePlays(std::vector<std::shared_ptr<Play>> &plays)
 {
-    auto newEnemyStrategy = recognizeEnemyStrategy();
+    // Strategy recognition only changes the result over several frames, so we allow it to be deferred on slow frames
+    auto newEnemyStrategy = enemyStrategy;
+    FrameScheduler::run("PvT::recognizeEnemyStrategy", 12, [&]()
+    {
+        newEnemyStrategy = recognizeEnemyStrategy();
+    });
     auto newStrategy = chooseOurStrategy(newEnemyStrategy, plays);
 
     if (enemyStrategy != newEnemyStrategy)
@@ -185,8 +185,7 @@ namespace
         auto grid = PathFinding::getNavigationGrid(enemyMain->getPosition());
         if (!grid) return false;
 
-        auto &node = (*grid)[mainChoke->center];
-        return node.nextNode == nullptr;
+        return !(*grid)[mainChoke->center].nextNode();
     }
 
     bool isMidGame()
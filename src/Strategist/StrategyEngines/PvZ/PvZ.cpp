@@ -1,6 +1,7 @@
 #include "StrategyEngines/PvZ.h"
 
 #include "Units.h"
+#include "FrameScheduler.h"
 #include "Map.h"
 #include "Strategist.h"
 #include "Players.h"
@@ -83,7 +84,12 @@ void PvZ::initialize(std::vector<std::shared_ptr<Play>> &plays, bool transitioni
 
 void PvZ::updatePlays(std::vector<std::shared_ptr<Play>> &plays)
 {
-    auto newEnemyStrategy = recognizeEnemyStrategy();
+    // Strategy recognition only changes the result over several frames, so we allow it to be deferred on slow frames
+    auto newEnemyStrategy = enemyStrategy;
+    FrameScheduler::run("PvZ::recognizeEnemyStrategy", 12, [&]()
+    {
+        newEnemyStrategy = recognizeEnemyStrategy();
+    });
     auto newStrategy = chooseOurStrategy(newEnemyStrategy, plays);
 
     if (enemyStrategy != newEnemyStrategy)
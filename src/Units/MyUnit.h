@@ -130,7 +130,10 @@ protected:
     NavigationGrid *grid;
 
     // The current grid node occupied by the unit in the above grid.
-    const NavigationGrid::GridNode *gridNode;
+    NavigationGrid::GridNode gridNode;
+
+    // The generation of the grid when gridNode was set. The grid may be released and rebuilt between frames.
+    unsigned int gridGeneration;
 
     // The last frame where we sent a move command to the unit.
     int lastMoveFrame;
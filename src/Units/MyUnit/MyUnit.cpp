@@ -20,7 +20,7 @@ MyUnitImpl::MyUnitImpl(BWAPI::Unit unit)
         , targetPosition(BWAPI::Positions::Invalid)
         , currentlyMovingTowards(BWAPI::Positions::Invalid)
         , grid(nullptr)
-        , gridNode(nullptr)
+        , gridGeneration(0)
         , lastMoveFrame(0)
         , unstickUntil(-1)
         , simulatedPositionsUpdated(false)
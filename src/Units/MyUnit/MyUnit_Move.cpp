@@ -22,16 +22,17 @@
 
 namespace
 {
-    const NavigationGrid::GridNode *nextNode(const NavigationGrid::GridNode *currentNode)
+    NavigationGrid::GridNode nextNode(const NavigationGrid::GridNode &currentNode)
     {
-        if (!currentNode || !currentNode->nextNode) return nullptr;
+        if (!currentNode || !currentNode.nextNode()) return {};
 
         // We prefer to go 5 tiles ahead, but accept an earlier tile if a later one is invalid
         auto node = currentNode;
         for (int i = 0; i < 5; i++)
         {
-            if (!node->nextNode) return node;
-            node = node->nextNode;
+            auto next = node.nextNode();
+            if (!next) return node;
+            node = next;
         }
 
         return node;
@@ -117,7 +118,7 @@ void MyUnitImpl::initiateMove()
     std::ostringstream log;
     log << "Order: Initiating move to " << BWAPI::WalkPosition(targetPosition);
     if (grid) log << "; grid target " << grid->goal;
-    if (gridNode) log << "; initial grid node " << *gridNode;
+    if (gridNode) log << "; initial grid node " << gridNode;
     CherryVis::log(id) << log.str();
 #endif
 
@@ -130,7 +131,7 @@ void MyUnitImpl::resetMoveData()
     currentlyMovingTowards = BWAPI::Positions::Invalid;
     grid = nullptr;
     chokePath.clear();
-    gridNode = nullptr;
+    gridNode = {};
 }
 
 bool MyUnitImpl::hasReachedNextChoke() const
@@ -152,14 +153,14 @@ bool MyUnitImpl::hasReachedNextChoke() const
 void MyUnitImpl::moveToNextWaypoint()
 {
     // Current grid node is close to the target (approx. 3 tiles away)
-    if (gridNode && gridNode->cost <= 90)
+    if (gridNode && gridNode.cost() <= 90)
     {
 #if DEBUG_UNIT_ORDERS
         CherryVis::log(id) << "Order: Reached end of grid " << grid->goal;
 #endif
 
         grid = nullptr;
-        gridNode = nullptr;
+        gridNode = {};
 
         // Short-circuit if the unit is in the target area
         // This means we are close to the destination and just need to do a simple move from here
@@ -189,10 +190,10 @@ void MyUnitImpl::moveToNextWaypoint()
         if (auto next = nextNode(gridNode))
         {
 #if DEBUG_UNIT_ORDERS
-            CherryVis::log(id) << "Order: Moving towards next grid node " << *next;
+            CherryVis::log(id) << "Order: Moving towards next grid node " << next;
 #endif
 
-            currentlyMovingTowards = next->center();
+            currentlyMovingTowards = next.center();
             move(currentlyMovingTowards);
 
             return;
@@ -299,15 +300,16 @@ void MyUnitImpl::updateMoveWaypoints()
     // We have a grid we can use for navigation
     if (grid)
     {
-        grid->update();
+        grid->updateInBackground();
 
-        // If we are no longer in the same node, update it and move to the next waypoint
-        if (tilePositionX != gridNode->x || tilePositionY != gridNode->y)
+        // If we are no longer in the same node, or the grid has been rebuilt since we got our node, update it and move to the next waypoint
+        if (gridGeneration != grid->generation || tilePositionX != gridNode.x() || tilePositionY != gridNode.y())
         {
-            gridNode = &(*grid)[getTilePosition()];
+            gridNode = (*grid)[getTilePosition()];
+            gridGeneration = grid->generation;
 
 #if DEBUG_UNIT_ORDERS
-            CherryVis::log(id) << "Order: Path node set to " << *gridNode;
+            CherryVis::log(id) << "Order: Path node set to " << gridNode;
 #endif
             moveToNextWaypoint();
             return;
@@ -315,10 +317,10 @@ void MyUnitImpl::updateMoveWaypoints()
 
         // Check if the waypoint we are currently using is still valid
         auto next = nextNode(gridNode);
-        if (next != nullptr)
+        if (next)
         {
             // React if a grid update has changed the desired waypoint
-            if (currentlyMovingTowards != next->center())
+            if (currentlyMovingTowards != next.center())
             {
                 moveToNextWaypoint();
             }
@@ -378,8 +380,8 @@ void MyUnitImpl::resetGrid()
                 // Don't use a grid if the current node is invalid or if the goal is very close
                 if (grid)
                 {
-                    auto &node = (*grid)[getTilePosition()];
-                    if (!node.nextNode || node.cost < 90)
+                    auto node = (*grid)[getTilePosition()];
+                    if (!node.nextNode() || node.cost() < 90)
                     {
                         grid = nullptr;
                     }
@@ -391,7 +393,11 @@ void MyUnitImpl::resetGrid()
     }
 
     // If we have a grid, get the first grid node
-    if (grid) gridNode = &(*grid)[bwapiUnit->getPosition()];
+    if (grid)
+    {
+        gridNode = (*grid)[bwapiUnit->getPosition()];
+        gridGeneration = grid->generation;
+    }
 }
 
 void MyUnitImpl::updateChokePath(const BWEM::Area *unitArea)
@@ -805,21 +805,21 @@ bool UnitImpl::updateSimPosition()
     }
 
     // Find the node where the path enters the fog
-    auto node = &(*grid)[vanguard->lastPosition];
-    while (node->nextNode && BWAPI::Broodwar->isVisible(node->x, node->y))
+    auto node = (*grid)[vanguard->lastPosition];
+    while (node.nextNode() && BWAPI::Broodwar->isVisible(node.x(), node.y()))
     {
-        node = node->nextNode;
+        node = node.nextNode();
     }
 
     // Detect if the search failed
-    if (!node->nextNode) return false;
+    if (!node.nextNode()) return false;
 
     // Set the position here to start with
-    simPosition = node->center();
+    simPosition = node.center();
     simPositionValid = true;
 
     // Try to scale the position further away where appropriate
-    BWAPI::Position vector(BWAPI::TilePosition(node->x - vanguard->tilePositionX, node->y - vanguard->tilePositionY));
+    BWAPI::Position vector(BWAPI::TilePosition(node.x() - vanguard->tilePositionX, node.y() - vanguard->tilePositionY));
     if (Geo::ApproximateDistance(vector.x, 0, vector.y, 0) < offsetToVanguardUnit)
     {
         auto scaledVector = Geo::ScaleVector(vector, offsetToVanguardUnit);
@@ -641,6 +641,12 @@ namespace Units
         for (auto &unit : myUnits) updateOrderProcessTimer(unit);
         for (auto &unit : enemyUnits) updateOrderProcessTimer(unit);
 
+        // Buffer grid changes while updating units, so units that morph or move several times only stamp their net change
+        auto &myGrid = Players::grid(BWAPI::Broodwar->self());
+        auto &enemyGrid = Players::grid(BWAPI::Broodwar->enemy());
+        myGrid.beginBatch();
+        enemyGrid.beginBatch();
+
         auto ignoreUnit = [](BWAPI::Unit bwapiUnit)
         {
             return bwapiUnit->getType() == BWAPI::UnitTypes::Protoss_Interceptor ||
@@ -763,6 +769,9 @@ namespace Units
             }
         }
 
+        // Our detection grid is read when updating enemy units in the fog, so it needs to be current before then
+        myGrid.applyBatch();
+
         // Update visible enemy units
         for (auto bwapiUnit : BWAPI::Broodwar->enemy()->getUnits())
         {
@@ -926,6 +935,8 @@ namespace Units
             resourceDestroyed(mineralFieldTile);
         }
 
+        enemyGrid.applyBatch();
+
         assignEnemyUnitsToBases();
 
         // Occasionally check for any inconsistencies in the enemy unit collections
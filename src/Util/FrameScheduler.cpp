@@ -0,0 +1,90 @@
+#include "FrameScheduler.h"
+
+#include <chrono>
+
+namespace FrameScheduler
+{
+    namespace
+    {
+        // Timings in debug and instrumented builds are dominated by the instrumentation itself, so we only defer work when
+        // things are seriously slow
+#ifdef DEBUG
+        const int DEFAULT_DEFER_THRESHOLD = 10000;
+#elif defined(INSTRUMENTATION_ENABLED_VERBOSE)
+        const int DEFAULT_DEFER_THRESHOLD = 1000;
+#elif defined(INSTRUMENTATION_ENABLED)
+        const int DEFAULT_DEFER_THRESHOLD = 80;
+#else
+        const int DEFAULT_DEFER_THRESHOLD = 35;
+#endif
+
+        struct Task
+        {
+            int lastRun = -1;
+            int runs = 0;
+            int skips = 0;
+        };
+
+        std::chrono::steady_clock::time_point frameStartPoint;
+        long long deferThresholdMicroseconds;
+        std::unordered_map<const char *, Task> tasks;
+    }
+
+    void initialize()
+    {
+        frameStartPoint = std::chrono::steady_clock::now();
+        deferThresholdMicroseconds = DEFAULT_DEFER_THRESHOLD * 1000;
+        tasks.clear();
+    }
+
+    void frameStart()
+    {
+        frameStartPoint = std::chrono::steady_clock::now();
+    }
+
+    void setDeferThreshold(int milliseconds)
+    {
+        deferThresholdMicroseconds = (long long) milliseconds * 1000;
+    }
+
+    long long elapsedMicroseconds()
+    {
+        return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - frameStartPoint).count();
+    }
+
+    bool isOverBudget()
+    {
+        return elapsedMicroseconds() > deferThresholdMicroseconds;
+    }
+
+    bool run(const char *label, int maxStaleness, const std::function<void()> &task)
+    {
+        auto &data = tasks[label];
+
+        if ((currentFrame - data.lastRun) <= maxStaleness && isOverBudget())
+        {
+            data.skips++;
+#if DEBUG_LOGGING_ENABLED
+            Log::Debug() << "Deferred " << label << "; frame elapsed " << elapsedMicroseconds() << "us";
+#endif
+            return false;
+        }
+
+        task();
+        data.lastRun = currentFrame;
+        data.runs++;
+        return true;
+    }
+
+    void writeSummary()
+    {
+        std::ostringstream msg;
+        msg << "Deferred task summary";
+        for (auto &[label, data] : tasks)
+        {
+            msg << "\n" << label << ": runs=" << data.runs << ", skips=" << data.skips;
+        }
+
+        Log::Get() << msg.str();
+    }
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include "Common.h"
+
+#include <functional>
+
+/*
+ * Keeps worst-case frame latency bounded by skipping non-critical work once the frame has run long.
+ *
+ * Critical work is just called directly. Deferrable work is wrapped in a call to run with a maximum staleness: it is skipped
+ * while the frame is over the defer threshold, unless it has already been skipped for maxStaleness consecutive frames.
+ */
+namespace FrameScheduler
+{
+    void initialize();
+
+    // Called at the start of each frame to reset the frame clock
+    void frameStart();
+
+    // Sets the elapsed frame time after which deferrable work is skipped
+    void setDeferThreshold(int milliseconds);
+
+    long long elapsedMicroseconds();
+
+    bool isOverBudget();
+
+    // Runs the task if the frame is within budget or the task has not run for maxStaleness frames.
+    // Returns whether the task was run.
+    // The label must be a string literal or otherwise outlive the game.
+    bool run(const char *label, int maxStaleness, const std::function<void()> &task);
+
+    // Writes how often each deferrable task was skipped to the log
+    void writeSummary();
+}
@@ -0,0 +1,199 @@
+#include "BWTest.h"
+#include "Opponents.h"
+#include "Common.h"
+#include "Timer.h"
+#include "FrameScheduler.h"
+
+#include <nlohmann.h>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <limits>
+
+/*
+ * Frame-latency benchmark.
+ *
+ * Plays a fixed set of games with fixed seeds against the bundled opponents and writes the frame time distribution of each
+ * Timer checkpoint and zone as JSON. Run it on a release build for representative timings.
+ *
+ * To keep the games the same between builds, the game and opponent C library seeds are pinned and deferral of work by the
+ * FrameScheduler is disabled, as otherwise a slower build would skip work and play a different game. Opponents that seed
+ * their own random number generators may still diverge, so the comparison flags games that ended on a different frame.
+ *
+ * Usage:
+ *   stardust-bench [output.json]                  Runs the benchmark games, by default writing to stardust-bench.json
+ *   stardust-bench --compare base.json new.json   Prints the per-module differences between two benchmark results
+ */
+
+namespace
+{
+    struct BenchGame
+    {
+        std::string opponentName;
+        BWAPI::Race opponentRace;
+        std::function<BWAPI::AIModule *()> opponentModule;
+        std::string map;
+        int frameLimit;
+    };
+
+    std::vector<BenchGame> benchGames()
+    {
+        return {
+                {"Steamhammer", BWAPI::Races::Zerg, BenchOpponents::steamhammer, "sscai/(2)Destination", 15000},
+                {"Locutus", BWAPI::Races::Protoss, BenchOpponents::locutus, "sscai/(4)Fighting Spirit", 15000},
+                {"Iron", BWAPI::Races::Terran, BenchOpponents::iron, "sscai/(2)Heartbreak Ridge", 15000},
+        };
+    }
+
+    std::string gameKey(const nlohmann::json &game)
+    {
+        return game["opponent"].get<std::string>() + "_" + game["map"].get<std::string>();
+    }
+
+    int runBenchmark(const std::string &outputFilename)
+    {
+        nlohmann::json result;
+        result["games"] = nlohmann::json::array();
+
+        for (auto &benchGame : benchGames())
+        {
+            auto map = Maps::GetOne(benchGame.map);
+            if (!map) return 1;
+
+            BWTest test;
+            test.opponentName = benchGame.opponentName;
+            test.opponentRace = benchGame.opponentRace;
+            test.opponentModule = benchGame.opponentModule;
+            test.map = map;
+            test.randomSeed = map->startLocationSeeds[0];
+            test.frameLimit = benchGame.frameLimit;
+            test.timeLimit = 3600;
+            test.expectWin = false;
+            test.writeReplay = false;
+            test.onStartOpponent = [&test]()
+            {
+                std::srand(test.randomSeed);
+                std::cout.setstate(std::ios_base::failbit);
+                std::cerr.setstate(std::ios_base::failbit);
+            };
+
+            test.onStartMine = []()
+            {
+                FrameScheduler::setDeferThreshold(std::numeric_limits<int>::max());
+            };
+
+            int frames = 0;
+            bool won = false;
+            test.onEndMine = [&](bool isWinner)
+            {
+                frames = currentFrame;
+                won = isWinner;
+            };
+
+            test.run();
+
+            nlohmann::json game;
+            game["opponent"] = benchGame.opponentName;
+            game["map"] = map->shortname();
+            game["seed"] = test.randomSeed;
+            game["frames"] = frames;
+            game["won"] = won;
+
+            nlohmann::json modules = nlohmann::json::object();
+            for (auto &stats : Timer::statistics())
+            {
+                modules[stats.label] = {
+                        {"n",    stats.count},
+                        {"mean", stats.mean},
+                        {"p50",  stats.p50},
+                        {"p95",  stats.p95},
+                        {"p99",  stats.p99},
+                        {"max",  stats.max}
+                };
+            }
+            game["modules"] = modules;
+
+            std::cout << "Finished " << gameKey(game) << " after " << frames << " frames" << std::endl;
+            result["games"].push_back(game);
+        }
+
+        std::ofstream file(outputFilename, std::ofstream::trunc);
+        file << std::setw(2) << result << std::endl;
+        std::cout << "Wrote results to " << outputFilename << std::endl;
+
+        return 0;
+    }
+
+    int compare(const std::string &baseFilename, const std::string &newFilename)
+    {
+        nlohmann::json base;
+        nlohmann::json candidate;
+        try
+        {
+            std::ifstream baseFile(baseFilename);
+            baseFile >> base;
+            std::ifstream newFile(newFilename);
+            newFile >> candidate;
+        }
+        catch (std::exception &ex)
+        {
+            std::cerr << "Unable to read benchmark results: " << ex.what() << std::endl;
+            return 1;
+        }
+
+        std::map<std::string, nlohmann::json> baseGames;
+        for (auto &game : base["games"])
+        {
+            baseGames[gameKey(game)] = game;
+        }
+
+        for (auto &game : candidate["games"])
+        {
+            auto it = baseGames.find(gameKey(game));
+            if (it == baseGames.end()) continue;
+
+            std::cout << gameKey(game) << " (frames " << it->second["frames"] << " -> " << game["frames"] << ")";
+            if (it->second["frames"] != game["frames"])
+            {
+                std::cout << " WARNING: the games diverged, so the timings are not directly comparable";
+            }
+            std::cout << std::endl;
+            auto &baseModules = it->second["modules"];
+            for (auto moduleIt = game["modules"].begin(); moduleIt != game["modules"].end(); moduleIt++)
+            {
+                auto label = moduleIt.key();
+                auto &stats = moduleIt.value();
+
+                auto baseStatsIt = baseModules.find(label);
+                if (baseStatsIt == baseModules.end()) continue;
+                auto &baseStats = *baseStatsIt;
+
+                std::cout << "  " << std::left << std::setw(48) << label << std::right;
+                for (auto key : {"p50", "p95", "p99", "max"})
+                {
+                    std::cout << " " << key << ": " << std::setw(7) << baseStats[key].get<long long>()
+                              << " -> " << std::setw(7) << stats[key].get<long long>();
+                }
+                std::cout << std::endl;
+            }
+        }
+
+        return 0;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    if (argc > 1 && std::string(argv[1]) == "--compare")
+    {
+        if (argc != 4)
+        {
+            std::cerr << "Usage: stardust-bench --compare base.json new.json" << std::endl;
+            return 1;
+        }
+
+        return compare(argv[2], argv[3]);
+    }
+
+    return runBenchmark(argc > 1 ? argv[1] : "stardust-bench.json");
+}
@@ -0,0 +1,14 @@
+#pragma once
+
+#include <BWAPI.h>
+
+// Factories for the bundled opponents
+// These are defined in separate translation units, as the opponents' headers conflict with each other
+namespace BenchOpponents
+{
+    BWAPI::AIModule *steamhammer();
+
+    BWAPI::AIModule *locutus();
+
+    BWAPI::AIModule *iron();
+}
@@ -0,0 +1,10 @@
+#include "Opponents.h"
+#include "Iron.h"
+
+namespace BenchOpponents
+{
+    BWAPI::AIModule *iron()
+    {
+        return new iron::Iron();
+    }
+}
@@ -0,0 +1,10 @@
+#include "Opponents.h"
+#include "LocutusBotModule.h"
+
+namespace BenchOpponents
+{
+    BWAPI::AIModule *locutus()
+    {
+        return new Locutus::LocutusBotModule();
+    }
+}
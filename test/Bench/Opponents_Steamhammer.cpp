@@ -0,0 +1,10 @@
+#include "Opponents.h"
+#include "UAlbertaBotModule.h"
+
+namespace BenchOpponents
+{
+    BWAPI::AIModule *steamhammer()
+    {
+        return new UAlbertaBot::UAlbertaBotModule();
+    }
+}
@@ -3,6 +3,7 @@
 #include "DoNothingStrategyEngine.h"
 
 #include "Map.h"
+#include "Units.h"
 #include "Strategist.h"
 #include "TestMainArmyAttackBasePlay.h"
 
@@ -101,6 +102,20 @@ namespace
         };
     }
 
+    // Sends our main army to attack the base at the given tile, returning the base
+    Base *startAttackingBase(BWAPI::TilePosition enemyMain)
+    {
+        auto baseToAttack = Map::baseNear(BWAPI::Position(enemyMain));
+
+        Strategist::setStrategyEngine(std::make_unique<DoNothingStrategyEngine>());
+
+        std::vector<std::shared_ptr<Play>> openingPlays;
+        openingPlays.emplace_back(std::make_shared<TestMainArmyAttackBasePlay>(baseToAttack, true));
+        Strategist::setOpening(openingPlays);
+
+        return baseToAttack;
+    }
+
     void attackBaseMine(BWTest &test, SimResults &results, BWAPI::TilePosition enemyMain)
     {
         test.frameLimit = 2000;
@@ -109,19 +124,14 @@ namespace
         test.myInitialUnits.emplace_back(BWAPI::UnitTypes::Protoss_Observer, computeCentroid(test.opponentInitialUnits), true);
 
         Base *baseToAttack;
-        test.onStartMine = [&baseToAttack]()
+        test.onStartMine = [&baseToAttack, enemyMain]()
         {
             CombatSim::setMaxIterations(ITERATIONS);
+            CombatSim::setCacheFrames(0);
 
             BWAPI::Broodwar->self()->setUpgradeLevel(BWAPI::UpgradeTypes::Singularity_Charge, 1);
 
-            baseToAttack = Map::baseNear(BWAPI::Position(BWAPI::TilePosition(7, 9)));
-
-            Strategist::setStrategyEngine(std::make_unique<DoNothingStrategyEngine>());
-
-            std::vector<std::shared_ptr<Play>> openingPlays;
-            openingPlays.emplace_back(std::make_shared<TestMainArmyAttackBasePlay>(baseToAttack, true));
-            Strategist::setOpening(openingPlays);
+            baseToAttack = startAttackingBase(enemyMain);
         };
 
         unsigned long lastCount = 0;
@@ -160,6 +170,57 @@ namespace
         };
     }
 
+    // Four of our dragoons attack a base defended by three attack-moving dragoons on Breakers
+    // onFrameMine is called with the cluster closest to the base and the enemy units near it, once there are any
+    void dragoonEngagement(BWTest &test,
+                           bool useSimCache,
+                           const std::function<void(AttackBaseSquad *squad,
+                                                    const std::shared_ptr<UnitCluster> &cluster,
+                                                    std::set<Unit> &enemyUnits)> &onFrameMine)
+    {
+        test.opponentRace = BWAPI::Races::Protoss;
+        test.map = Maps::GetOne("Breakers");
+        test.randomSeed = 62090;
+        test.frameLimit = 1000;
+        test.expectWin = false;
+        test.myInitialUnits = {
+                UnitTypeAndPosition(BWAPI::UnitTypes::Protoss_Dragoon, BWAPI::Position(1659, 1412), true),
+                UnitTypeAndPosition(BWAPI::UnitTypes::Protoss_Dragoon, BWAPI::Position(1697, 1468), true),
+                UnitTypeAndPosition(BWAPI::UnitTypes::Protoss_Dragoon, BWAPI::Position(1635, 1479), true),
+                UnitTypeAndPosition(BWAPI::UnitTypes::Protoss_Dragoon, BWAPI::Position(1609, 1434), true),
+        };
+        test.opponentInitialUnits = {
+                UnitTypeAndPosition(BWAPI::UnitTypes::Protoss_Dragoon, BWAPI::Position(1178, 1376), true),
+                UnitTypeAndPosition(BWAPI::UnitTypes::Protoss_Dragoon, BWAPI::Position(1331, 1241), true),
+                UnitTypeAndPosition(BWAPI::UnitTypes::Protoss_Dragoon, BWAPI::Position(1318, 1319), true),
+        };
+
+        attackMoveOpponent(test);
+
+        auto baseToAttack = std::make_shared<Base *>(nullptr);
+        test.onStartMine = [baseToAttack, useSimCache]()
+        {
+            if (!useSimCache) CombatSim::setCacheFrames(0);
+
+            *baseToAttack = startAttackingBase(BWAPI::TilePosition(7, 9));
+        };
+
+        test.onFrameMine = [baseToAttack, onFrameMine]()
+        {
+            auto squad = General::getAttackBaseSquad(*baseToAttack);
+            if (!squad) return;
+
+            auto cluster = squad->vanguardCluster();
+            if (!cluster) return;
+
+            std::set<Unit> enemyUnits;
+            Units::enemyInRadius(enemyUnits, cluster->center, 640);
+            if (enemyUnits.empty()) return;
+
+            onFrameMine(squad, cluster, enemyUnits);
+        };
+    }
+
     void outputResults(BWTest &test, SimResults &results)
     {
 #if !(DEBUG_COMBATSIM_EACHFRAME)
@@ -448,3 +509,82 @@ TEST(CombatSimEvaluation, Bridge_Dragoons_HoldPosition_Outnumbered)
 
     test.run();
 }
+
+TEST(CombatSimEvaluation, ParallelSimsMatchFrameThread)
+{
+    BWTest test;
+
+    // Runs a batch of identical sims on the sim threads and checks they all match the same sim run on the frame thread
+    // Reused results wouldn't be computed from the exact state the jobs see, so the cache is disabled
+    int comparedFrames = 0;
+    dragoonEngagement(test, false, [&comparedFrames](AttackBaseSquad *squad,
+                                                     const std::shared_ptr<UnitCluster> &cluster,
+                                                     std::set<Unit> &enemyUnits)
+    {
+        auto unitsAndTargets = cluster->selectTargets(enemyUnits, squad->getTargetPosition());
+
+        std::vector<std::shared_ptr<CombatSim::Job>> jobs;
+        for (int i = 0; i < 4; i++)
+        {
+            jobs.push_back(cluster->prepareCombatSim(squad->getTargetPosition(), unitsAndTargets, enemyUnits, squad->getDetectors()));
+        }
+        CombatSim::run(jobs);
+
+        auto expected = cluster->runCombatSim(squad->getTargetPosition(), unitsAndTargets, enemyUnits, squad->getDetectors());
+        for (auto &job : jobs)
+        {
+            auto result = cluster->combatSimResult(*job);
+            EXPECT_EQ(result.initialMine, expected.initialMine);
+            EXPECT_EQ(result.initialEnemy, expected.initialEnemy);
+            EXPECT_EQ(result.finalMine, expected.finalMine);
+            EXPECT_EQ(result.finalEnemy, expected.finalEnemy);
+        }
+
+        comparedFrames++;
+    });
+
+    test.onEndMine = [&](bool)
+    {
+        EXPECT_GT(comparedFrames, 0);
+    };
+
+    test.run();
+}
+
+TEST(CombatSimEvaluation, CacheMissesWhenStimChanges)
+{
+    BWTest test;
+
+    // Checks that the same sim is taken from the cache, but a sim where one of our units is stimmed is not
+    int checkedFrames = 0;
+    dragoonEngagement(test, true, [&checkedFrames](AttackBaseSquad *squad,
+                                                   const std::shared_ptr<UnitCluster> &cluster,
+                                                   std::set<Unit> &enemyUnits)
+    {
+        auto unitsAndTargets = cluster->selectTargets(enemyUnits, squad->getTargetPosition());
+        if (unitsAndTargets.empty()) return;
+
+        cluster->runCombatSim(squad->getTargetPosition(), unitsAndTargets, enemyUnits, squad->getDetectors());
+
+        auto unchanged = cluster->prepareCombatSim(squad->getTargetPosition(), unitsAndTargets, enemyUnits, squad->getDetectors());
+        EXPECT_TRUE(CombatSim::isCached(*unchanged));
+
+        auto &unit = unitsAndTargets.begin()->first;
+        auto stimmedUntil = unit->stimmedUntil;
+        unit->stimmedUntil = currentFrame + 100;
+
+        auto stimmed = cluster->prepareCombatSim(squad->getTargetPosition(), unitsAndTargets, enemyUnits, squad->getDetectors());
+        EXPECT_FALSE(CombatSim::isCached(*stimmed));
+
+        unit->stimmedUntil = stimmedUntil;
+
+        checkedFrames++;
+    });
+
+    test.onEndMine = [&](bool)
+    {
+        EXPECT_GT(checkedFrames, 0);
+    };
+
+    test.run();
+}
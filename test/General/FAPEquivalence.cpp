@@ -0,0 +1,320 @@
+#include "BWTest.h"
+#include "DoNothingModule.h"
+
+#include "Common.h"
+#include <fap.h>
+
+#include <random>
+
+namespace
+{
+    const BWAPI::UnitType battleUnitTypes[] = {
+            BWAPI::UnitTypes::Protoss_Zealot,
+            BWAPI::UnitTypes::Protoss_Dragoon,
+            BWAPI::UnitTypes::Terran_Marine,
+            BWAPI::UnitTypes::Terran_Siege_Tank_Siege_Mode,
+            BWAPI::UnitTypes::Zerg_Zergling,
+            BWAPI::UnitTypes::Zerg_Mutalisk,
+            BWAPI::UnitTypes::Zerg_Hydralisk,
+            BWAPI::UnitTypes::Terran_Vulture,
+            BWAPI::UnitTypes::Terran_Bunker,
+            BWAPI::UnitTypes::Terran_Medic,
+            BWAPI::UnitTypes::Terran_Goliath,
+            BWAPI::UnitTypes::Zerg_Scourge,
+            BWAPI::UnitTypes::Protoss_Photon_Cannon
+    };
+
+    struct SimUnit
+    {
+        BWAPI::UnitType type;
+        BWAPI::Position position;
+        int elevation;
+        int cooldown;
+        bool undetected;
+        int target;
+    };
+
+    struct Battle
+    {
+        std::vector<SimUnit> player1;
+        std::vector<SimUnit> player2;
+        BWAPI::Position player1Target;
+        BWAPI::Position player2Target;
+        bool choke = false;
+    };
+
+    // A battle between randomly-chosen units; the same seed always gives the same battle
+    Battle randomBattle(unsigned int seed, int player1Count, int player2Count, int separation, bool choke)
+    {
+        std::mt19937 rng(seed);
+        auto mapWidth = BWAPI::Broodwar->mapWidth() * 32;
+        auto mapHeight = BWAPI::Broodwar->mapHeight() * 32;
+
+        Battle battle;
+        int spread = 64 + (int)(rng() % 1500);
+        int ax = 1000 + (int)(rng() % 2000);
+        int ay = 1000 + (int)(rng() % 2000);
+        int bx = ax + (int)(rng() % separation) - separation / 2;
+        int by = ay + (int)(rng() % separation) - separation / 2;
+        if (choke)
+        {
+            ax = 3000;
+            bx = 3500;
+            ay = by = 3000;
+            battle.choke = true;
+        }
+        battle.player1Target = BWAPI::Position(bx, by);
+        battle.player2Target = BWAPI::Position(ax, ay);
+
+        auto addUnits = [&](std::vector<SimUnit> &units, int count, int cx, int cy)
+        {
+            for (int i = 0; i < count; i++)
+            {
+                auto type = battleUnitTypes[rng() % (sizeof(battleUnitTypes) / sizeof(battleUnitTypes[0]))];
+                int x = std::clamp(cx + (int)(rng() % spread) - spread / 2, 0, mapWidth - 1);
+                int y = std::clamp(cy + (int)(rng() % spread) - spread / 2, 0, mapHeight - 1);
+                int elevation = (int)(rng() % 3);
+                int cooldown = (int)(rng() % 5);
+                bool undetected = rng() % 20 == 0;
+                int target = rng() % 3 == 0 ? (int)(rng() % 200) : 0;
+                units.push_back({type, BWAPI::Position(x, y), elevation, cooldown, undetected, target});
+            }
+        };
+        addUnits(battle.player1, player1Count, ax, ay);
+        addUnits(battle.player2, player2Count, bx, by);
+
+        return battle;
+    }
+
+    // The dragoon engagements from the combat sim evaluation scenarios
+    Battle dragoonBattle(const std::vector<BWAPI::Position> &player1, const std::vector<BWAPI::Position> &player2)
+    {
+        Battle battle;
+        for (auto &position : player1)
+        {
+            battle.player1.push_back({BWAPI::UnitTypes::Protoss_Dragoon, position, 0, 0, false, 0});
+        }
+        for (auto &position : player2)
+        {
+            battle.player2.push_back({BWAPI::UnitTypes::Protoss_Dragoon, position, 0, 0, false, 0});
+        }
+        battle.player1Target = player2[0];
+        battle.player2Target = player1[0];
+        return battle;
+    }
+
+    auto makeUnit(const SimUnit &unit, int id, BWAPI::Position target)
+    {
+        auto type = unit.type;
+        return FAP::makeUnit<>()
+                .setUnitType(type)
+                .setPosition(unit.position)
+                .setTargetPosition(target)
+                .setHealth(type.maxHitPoints())
+                .setShields(type.maxShields())
+                .setFlying(type.isFlyer())
+                .setSpeed((float)type.topSpeed())
+                .setArmor(type.armor())
+                .setGroundCooldown(type.groundWeapon().damageCooldown())
+                .setGroundDamage(type.groundWeapon().damageAmount())
+                .setGroundMaxRange(type.groundWeapon().maxRange())
+                .setAirCooldown(type.airWeapon().damageCooldown())
+                .setAirDamage(type.airWeapon().damageAmount())
+                .setAirMaxRange(type.airWeapon().maxRange())
+                .setElevation(unit.elevation)
+                .setAttackerCount(type == BWAPI::UnitTypes::Terran_Bunker ? 4 : 8)
+                .setAttackCooldownRemaining(unit.cooldown)
+                .setSpeedUpgrade(false)
+                .setRangeUpgrade(false)
+                .setShieldUpgrades(0)
+                .setStimmed(false)
+                .setUndetected(unit.undetected)
+                .setID(id)
+                .setTarget(unit.target)
+                .setCollisionValues(3, 6)
+                .setData({});
+    }
+
+    // Simulates the battle frame-by-frame and returns the final state of all units
+    std::string simulate(const Battle &battle, int frames)
+    {
+        auto cells = BWAPI::Broodwar->mapWidth() * BWAPI::Broodwar->mapHeight() * 4;
+        std::vector<unsigned char> collision1(cells);
+        std::vector<unsigned char> collision2(cells);
+        std::vector<signed char> tileSide(cells);
+        for (int y = 0; y < BWAPI::Broodwar->mapHeight() * 2; y++)
+        {
+            for (int x = 0; x < BWAPI::Broodwar->mapWidth() * 2; x++)
+            {
+                tileSide[x + y * BWAPI::Broodwar->mapWidth() * 2] = x < 200 ? -1 : (x < 210 ? 0 : 1);
+            }
+        }
+
+        FAP::FastAPproximation<> sim(collision1, collision2);
+        if (battle.choke)
+        {
+            sim.setChokeGeometry(tileSide, {3100, 3000}, {3400, 3000}, {3000, 3000}, {3500, 3000});
+        }
+
+        for (size_t i = 0; i < battle.player1.size(); i++)
+        {
+            auto unit = makeUnit(battle.player1[i], (int)i + 1, battle.player1Target);
+            battle.choke ? sim.addPlayer1<true>(std::move(unit)) : sim.addPlayer1(std::move(unit));
+        }
+        for (size_t i = 0; i < battle.player2.size(); i++)
+        {
+            auto unit = makeUnit(battle.player2[i], (int)i + 100, battle.player2Target);
+            battle.choke ? sim.addPlayer2<true>(std::move(unit)) : sim.addPlayer2(std::move(unit));
+        }
+
+        for (int f = 0; f < frames; f++)
+        {
+            battle.choke ? sim.simulate<true, true>(1) : sim.simulate<true, false>(1);
+        }
+
+        std::ostringstream state;
+        auto units = sim.getState();
+        for (auto playerUnits : {units.first, units.second})
+        {
+            state << "|";
+            for (auto &unit : *playerUnits)
+            {
+                state << unit.id << ":" << unit.x << "," << unit.y << "," << unit.health << "," << unit.shields << ","
+                      << unit.target << "," << unit.attackCooldownRemaining << ";";
+            }
+        }
+        return state.str();
+    }
+
+    std::vector<Battle> battles()
+    {
+        std::vector<Battle> result;
+
+        // OpenGround_Dragoons_AttackMove_LargeNumber_Outnumbering
+        result.push_back(dragoonBattle(
+                {{1659, 1412}, {1697, 1468}, {1635, 1479}, {1609, 1434}, {1635, 1515}},
+                {{1178, 1376}, {1331, 1241}, {1318, 1319}, {1270, 1378}}));
+
+        // OpenGround_Dragoons_AttackMove_LargeNumber_Outnumbered
+        result.push_back(dragoonBattle(
+                {{1659, 1412}, {1697, 1468}, {1635, 1479}, {1609, 1434}},
+                {{1178, 1376}, {1212, 1376}, {1331, 1241}, {1318, 1319}, {1270, 1378}}));
+
+        // Bridge_Dragoons_AttackMove_Outnumbering
+        result.push_back(dragoonBattle(
+                {{1120, 1383}, {1068, 1378}, {1120, 1423}, {1068, 1418}},
+                {{735, 1228}, {705, 1148}, {767, 1151}}));
+
+        // Mixed battles on both sides of the target index and bin thresholds, with and without a choke
+        for (unsigned int seed = 0; seed < 24; seed++)
+        {
+            int player1Count = 1 + (int)(seed * 13) % 150;
+            int player2Count = 1 + (int)(seed * 7) % 150;
+            result.push_back(randomBattle(seed, player1Count, player2Count, (seed % 3) ? 800 : 3000, seed % 4 == 3));
+        }
+
+        return result;
+    }
+
+    unsigned long long checksum(const std::string &state)
+    {
+        unsigned long long result = 14695981039346656037ULL;
+        for (unsigned char c : state)
+        {
+            result ^= c;
+            result *= 1099511628211ULL;
+        }
+        return result;
+    }
+
+    void runInGame(const std::function<void()> &check)
+    {
+        BWTest test;
+        test.opponentModule = []()
+        {
+            return new DoNothingModule();
+        };
+        test.map = Maps::GetOne("Fighting Spirit");
+        test.randomSeed = 42;
+        test.frameLimit = 10;
+        test.expectWin = false;
+        test.onStartMine = check;
+
+        test.run();
+    }
+}
+
+// Target acquisition through the binned index must pick exactly the same targets as the linear scan
+TEST(FAPEquivalence, IndexedTargetingMatchesLinearScan)
+{
+    runInGame([]()
+              {
+                  auto indexMinUnits = FAP::targetIndexMinUnits;
+                  auto binsMinUnits = FAP::targetBinsMinUnits;
+
+                  for (auto &battle : battles())
+                  {
+                      FAP::targetIndexMinUnits = SIZE_MAX;
+                      auto linear = simulate(battle, 150);
+
+                      FAP::targetIndexMinUnits = 1;
+                      FAP::targetBinsMinUnits = SIZE_MAX;
+                      auto singleBin = simulate(battle, 150);
+
+                      FAP::targetBinsMinUnits = 1;
+                      auto binned = simulate(battle, 150);
+
+                      FAP::targetIndexMinUnits = indexMinUnits;
+                      FAP::targetBinsMinUnits = binsMinUnits;
+
+                      EXPECT_EQ(linear, singleBin);
+                      EXPECT_EQ(linear, binned);
+                  }
+              });
+}
+
+// Final states of the same battles simulated with the FAP that scanned targets linearly and erased dead units immediately
+// Tombstoning and compacting dead units once per frame must give the same results
+TEST(FAPEquivalence, MatchesOriginalImplementation)
+{
+    const unsigned long long expected[] = {
+            7918846364303936901ULL,
+            2921794043062444457ULL,
+            16693885239952364323ULL,
+            5677278126499325032ULL,
+            759728151466432785ULL,
+            17228983443705664595ULL,
+            12073958403240248910ULL,
+            15869328156735828343ULL,
+            7741082901744750475ULL,
+            9955243311963456425ULL,
+            10061042500430824844ULL,
+            5502536991261443050ULL,
+            4976063398467162020ULL,
+            9508871587248738078ULL,
+            11645788564190122014ULL,
+            5439763852130429733ULL,
+            11491100968307502872ULL,
+            1216632844852312932ULL,
+            7708121015172286784ULL,
+            12664454584019074667ULL,
+            2838918809869544418ULL,
+            9770341797779340069ULL,
+            837165747945529403ULL,
+            4036397460427851401ULL,
+            9410452167357502778ULL,
+            1673674586342774735ULL,
+            10529996455687113170ULL
+    };
+
+    runInGame([&expected]()
+              {
+                  auto allBattles = battles();
+                  ASSERT_EQ(allBattles.size(), sizeof(expected) / sizeof(expected[0]));
+
+                  for (size_t i = 0; i < allBattles.size(); i++)
+                  {
+                      EXPECT_EQ(checksum(simulate(allBattles[i], 150)), expected[i]) << "battle " << i;
+                  }
+              });
+}
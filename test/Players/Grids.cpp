@@ -2,10 +2,43 @@
 #include "DoNothingModule.h"
 
 #include "Players.h"
+#include "Units.h"
 #include "Map.h"
 #include "Strategist.h"
 #include "TestAttackBasePlay.h"
 
+namespace
+{
+    // Compares the incrementally-updated enemy grid with one built from scratch from the current enemy units
+    int enemyGridMismatches()
+    {
+        auto &grid = Players::grid(BWAPI::Broodwar->enemy());
+        Grid reference(std::make_shared<UpgradeTracker>(BWAPI::Broodwar->enemy()), BWAPI::Broodwar->enemy());
+        for (auto &unit : Units::allEnemy())
+        {
+            if (!unit->lastPositionValid || unit->beingManufacturedOrCarried) continue;
+
+            reference.unitCreated(unit->type, unit->lastPosition, unit->completed, unit->burrowed, unit->immobile);
+        }
+
+        int mismatches = 0;
+        for (int x = 0; x < BWAPI::Broodwar->mapWidth() * 4; x++)
+        {
+            for (int y = 0; y < BWAPI::Broodwar->mapHeight() * 4; y++)
+            {
+                if (grid.collision(x, y) != reference.collision(x, y)) mismatches++;
+                if (grid.groundThreat(x, y) != reference.groundThreat(x, y)) mismatches++;
+                if (grid.staticGroundThreat(x, y) != reference.staticGroundThreat(x, y)) mismatches++;
+                if (grid.airThreat(x, y) != reference.airThreat(x, y)) mismatches++;
+                if (grid.detection(x, y) != reference.detection(x, y)) mismatches++;
+                if (grid.stasisRange(x, y) != reference.stasisRange(x, y)) mismatches++;
+            }
+        }
+
+        return mismatches;
+    }
+}
+
 TEST(Grids, ObservedBurrowingLurker)
 {
     BWTest test;
@@ -141,3 +174,204 @@ TEST(Grids, DiscoveredBurrowedLurker)
 
     test.run();
 }
+
+TEST(Grids, BatchedUpdatesMatchRebuild)
+{
+    BWTest test;
+    test.opponentRace = BWAPI::Races::Zerg;
+    test.opponentModule = []()
+    {
+        return new DoNothingModule();
+    };
+    test.map = Maps::GetOne("Fighting Spirit");
+    test.randomSeed = 42;
+    test.frameLimit = 300;
+    test.expectWin = false;
+
+    test.myInitialUnits = {
+            UnitTypeAndPosition(BWAPI::UnitTypes::Protoss_Observer, BWAPI::TilePosition(100, 12))
+    };
+
+    // Enemy has some units that will move back and forth
+    test.opponentInitialUnits = {
+            UnitTypeAndPosition(BWAPI::UnitTypes::Zerg_Zergling, BWAPI::TilePosition(98, 10)),
+            UnitTypeAndPosition(BWAPI::UnitTypes::Zerg_Zergling, BWAPI::TilePosition(99, 10)),
+            UnitTypeAndPosition(BWAPI::UnitTypes::Zerg_Hydralisk, BWAPI::TilePosition(100, 10)),
+            UnitTypeAndPosition(BWAPI::UnitTypes::Zerg_Mutalisk, BWAPI::TilePosition(101, 10)),
+            UnitTypeAndPosition(BWAPI::UnitTypes::Zerg_Overlord, BWAPI::TilePosition(102, 10))
+    };
+
+    test.onFrameOpponent = []()
+    {
+        if (BWAPI::Broodwar->getFrameCount() % 4 != 0) return;
+
+        auto target = (BWAPI::Broodwar->getFrameCount() % 8 == 0)
+                      ? BWAPI::Position(BWAPI::TilePosition(96, 14))
+                      : BWAPI::Position(BWAPI::TilePosition(104, 8));
+        for (auto &unit : BWAPI::Broodwar->self()->getUnits())
+        {
+            unit->move(target);
+        }
+    };
+
+    test.onFrameMine = []()
+    {
+        if (BWAPI::Broodwar->getFrameCount() % 10 != 0) return;
+
+        EXPECT_EQ(enemyGridMismatches(), 0);
+    };
+
+    test.run();
+}
+
+TEST(Grids, BatchedUpdatesMatchRebuildWithSiegeTanks)
+{
+    BWTest test;
+    test.opponentRace = BWAPI::Races::Terran;
+    test.opponentModule = []()
+    {
+        return new DoNothingModule();
+    };
+    test.map = Maps::GetOne("Fighting Spirit");
+    test.randomSeed = 42;
+    test.frameLimit = 500;
+    test.expectWin = false;
+
+    test.myInitialUnits = {
+            UnitTypeAndPosition(BWAPI::UnitTypes::Protoss_Observer, BWAPI::TilePosition(100, 12))
+    };
+
+    // Enemy has tanks that siege and unsiege, and marines that move back and forth
+    test.opponentInitialUnits = {
+            UnitTypeAndPosition(BWAPI::UnitTypes::Terran_Siege_Tank_Tank_Mode, BWAPI::TilePosition(98, 10)),
+            UnitTypeAndPosition(BWAPI::UnitTypes::Terran_Siege_Tank_Tank_Mode, BWAPI::TilePosition(102, 10)),
+            UnitTypeAndPosition(BWAPI::UnitTypes::Terran_Marine, BWAPI::TilePosition(99, 12)),
+            UnitTypeAndPosition(BWAPI::UnitTypes::Terran_Marine, BWAPI::TilePosition(101, 12))
+    };
+
+    test.onStartOpponent = []()
+    {
+        BWAPI::Broodwar->self()->setResearched(BWAPI::TechTypes::Tank_Siege_Mode, true);
+    };
+
+    // Tanks alternate between siege and tank mode, and get a weapon upgrade part-way through while sieged
+    test.onFrameOpponent = []()
+    {
+        if (BWAPI::Broodwar->getFrameCount() == 250)
+        {
+            BWAPI::Broodwar->self()->setUpgradeLevel(BWAPI::UpgradeTypes::Terran_Vehicle_Weapons, 1);
+            BWAPI::Broodwar->self()->setUpgradeLevel(BWAPI::UpgradeTypes::Terran_Infantry_Weapons, 1);
+        }
+
+        if (BWAPI::Broodwar->getFrameCount() % 4 != 0) return;
+
+        auto target = (BWAPI::Broodwar->getFrameCount() % 8 == 0)
+                      ? BWAPI::Position(BWAPI::TilePosition(96, 14))
+                      : BWAPI::Position(BWAPI::TilePosition(104, 14));
+        bool siege = (BWAPI::Broodwar->getFrameCount() / 120) % 2 == 0;
+        for (auto &unit : BWAPI::Broodwar->self()->getUnits())
+        {
+            if (unit->getType() == BWAPI::UnitTypes::Terran_Marine)
+            {
+                unit->move(target);
+            }
+            else if (siege && unit->getType() == BWAPI::UnitTypes::Terran_Siege_Tank_Tank_Mode)
+            {
+                unit->siege();
+            }
+            else if (!siege && unit->getType() == BWAPI::UnitTypes::Terran_Siege_Tank_Siege_Mode)
+            {
+                unit->unsiege();
+            }
+        }
+    };
+
+    test.onFrameMine = []()
+    {
+        if (BWAPI::Broodwar->getFrameCount() % 10 != 0) return;
+
+        EXPECT_EQ(enemyGridMismatches(), 0);
+    };
+
+    test.run();
+}
+
+TEST(Grids, RegionQueriesMatchScan)
+{
+    BWTest test;
+    test.opponentRace = BWAPI::Races::Zerg;
+    test.opponentModule = []()
+    {
+        return new DoNothingModule();
+    };
+    test.map = Maps::GetOne("Fighting Spirit");
+    test.randomSeed = 42;
+    test.frameLimit = 50;
+    test.expectWin = false;
+
+    test.myInitialUnits = {
+            UnitTypeAndPosition(BWAPI::UnitTypes::Protoss_Observer, BWAPI::TilePosition(100, 12))
+    };
+
+    test.opponentInitialUnits = {
+            UnitTypeAndPosition(BWAPI::UnitTypes::Zerg_Hydralisk, BWAPI::TilePosition(98, 10)),
+            UnitTypeAndPosition(BWAPI::UnitTypes::Zerg_Spore_Colony, BWAPI::TilePosition(102, 14)),
+            UnitTypeAndPosition(BWAPI::UnitTypes::Zerg_Sunken_Colony, BWAPI::TilePosition(94, 16))
+    };
+
+    test.onFrameMine = []()
+    {
+        if (BWAPI::Broodwar->getFrameCount() != 40) return;
+
+        auto &grid = Players::grid(BWAPI::Broodwar->enemy());
+
+        auto scanMax = [](BWAPI::Position topLeft, BWAPI::Position bottomRight, bool air)
+        {
+            long result = 0;
+            for (int x = topLeft.x >> 3U; x <= bottomRight.x >> 3U; x++)
+            {
+                for (int y = topLeft.y >> 3U; y <= bottomRight.y >> 3U; y++)
+                {
+                    auto &grid = Players::grid(BWAPI::Broodwar->enemy());
+                    result = std::max(result, air ? grid.airThreat(x, y) : grid.groundThreat(x, y));
+                }
+            }
+            return result;
+        };
+
+        auto scanSum = [](BWAPI::Position topLeft, BWAPI::Position bottomRight)
+        {
+            long result = 0;
+            for (int x = topLeft.x >> 3U; x <= bottomRight.x >> 3U; x++)
+            {
+                for (int y = topLeft.y >> 3U; y <= bottomRight.y >> 3U; y++)
+                {
+                    result += Players::grid(BWAPI::Broodwar->enemy()).groundThreat(x, y);
+                }
+            }
+            return result;
+        };
+
+        // Rectangles of various sizes and alignments around and away from the enemy units
+        for (int size : {8, 37, 130, 600})
+        {
+            for (int x = 2500; x < 3600; x += 97)
+            {
+                for (int y = 100; y < 900; y += 89)
+                {
+                    BWAPI::Position topLeft(x, y);
+                    BWAPI::Position bottomRight(std::min(x + size, 4095), std::min(y + size, 4095));
+                    EXPECT_EQ(grid.maxGroundThreatInRect(topLeft, bottomRight), scanMax(topLeft, bottomRight, false));
+                    EXPECT_EQ(grid.maxAirThreatInRect(topLeft, bottomRight), scanMax(topLeft, bottomRight, true));
+                    EXPECT_EQ(grid.sumGroundThreatInRect(topLeft, bottomRight), scanSum(topLeft, bottomRight));
+                }
+            }
+        }
+
+        // A segment through the spore colony is threatened, one far away from it is not
+        EXPECT_TRUE(grid.anyAirThreatAlong(BWAPI::Position(BWAPI::TilePosition(90, 15)), BWAPI::Position(BWAPI::TilePosition(110, 15))));
+        EXPECT_FALSE(grid.anyAirThreatAlong(BWAPI::Position(BWAPI::TilePosition(10, 100)), BWAPI::Position(BWAPI::TilePosition(30, 120))));
+    };
+
+    test.run();
+}
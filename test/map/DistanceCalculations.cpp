@@ -2,6 +2,7 @@
 
 #include "DoNothingModule.h"
 #include "PathFinding.h"
+#include "Map.h"
 
 TEST(DistanceCalculations, BlueStorm)
 {
@@ -23,3 +24,42 @@ TEST(DistanceCalculations, BlueStorm)
     };
     test.run();
 }
+
+TEST(DistanceCalculations, BatchedMatchesScalar)
+{
+    BWTest test;
+    test.map = Maps::GetOne("Plasma");
+    test.opponentModule = []()
+    {
+        return new DoNothingModule();
+    };
+    test.frameLimit = 10;
+    test.expectWin = false;
+
+    test.onStartMine = []()
+    {
+        std::vector<BWAPI::Position> positions;
+        for (auto base : Map::allBases())
+        {
+            positions.push_back(base->getPosition());
+        }
+
+        // Probes can mineral walk, so some of these need our own choke point search
+        // Expansion scoring uses the nearest BWEM areas, so check with and without that option
+        for (auto type : {BWAPI::UnitTypes::Protoss_Probe, BWAPI::UnitTypes::Protoss_Dragoon})
+        {
+            for (auto options : {PathFinding::PathFindingOptions::Default, PathFinding::PathFindingOptions::UseNearestBWEMArea})
+            {
+                for (auto &position : positions)
+                {
+                    auto distances = PathFinding::GetGroundDistances(position, positions, type, options);
+                    for (size_t i = 0; i < positions.size(); i++)
+                    {
+                        EXPECT_EQ(distances[i], PathFinding::GetGroundDistance(position, positions[i], type, options));
+                    }
+                }
+            }
+        }
+    };
+    test.run();
+}
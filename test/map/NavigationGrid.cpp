@@ -4,6 +4,9 @@
 #include "Units.h"
 #include "Map.h"
 #include "PathFinding.h"
+#include "MapDataCache.h"
+
+#include <filesystem>
 
 namespace
 {
@@ -16,15 +19,15 @@ namespace
         {
             for (int x = 0; x < BWAPI::Broodwar->mapWidth(); x++)
             {
-                auto &node = grid[BWAPI::TilePosition(x, y)];
+                auto node = grid[BWAPI::TilePosition(x, y)];
 
-                if (node.cost > 0 && node.cost < USHRT_MAX && !node.nextNode)
+                if (node.cost() > 0 && node.cost() < USHRT_MAX && !node.nextNode())
                 {
                     std::cout << BWAPI::Broodwar->getFrameCount() << ": Node with no next node " << node << std::endl;
                     return false;
                 }
 
-                if (node.cost == 0 && node.nextNode)
+                if (node.cost() == 0 && node.nextNode())
                 {
                     std::cout << BWAPI::Broodwar->getFrameCount() << ": Goal node with next node " << node << std::endl;
                     return false;
@@ -32,7 +35,7 @@ namespace
 
                 // Doesn't work as there are walkable areas behind doodads that can't be reached
                 /*
-                if (Map::unwalkableProximity(node.x, node.y) >= 2 && node.cost == USHRT_MAX &&
+                if (Map::unwalkableProximity(node.x(), node.y()) >= 2 && node.cost() == USHRT_MAX &&
                     PathFinding::GetGroundDistance(BWAPI::Position(BWAPI::TilePosition(x, y)), BWAPI::Position(grid.goal)) != -1)
                 {
                     std::cout << "Should be path from " << node << std::endl;
@@ -40,9 +43,9 @@ namespace
                 }
                 */
 
-                if (node.nextNode)
+                if (node.nextNode())
                 {
-                    int costDiff = node.cost - node.nextNode->cost;
+                    int costDiff = node.cost() - node.nextNode().cost();
                     if (costDiff <= 0)
                     {
                         std::cout << BWAPI::Broodwar->getFrameCount() << ": Non-decreasing cost " << node << std::endl;
@@ -53,24 +56,24 @@ namespace
                     if (costDiff > maxCostDiff) maxCostDiff = costDiff;
                 }
 
-                auto current = node.nextNode;
+                auto current = node.nextNode();
                 int i = 0;
-                while (current != nullptr && i < 5)
+                while (current && i < 5)
                 {
-                    if (current == &node)
+                    if (current == node)
                     {
-                        std::cout << BWAPI::Broodwar->getFrameCount() << ": Loop between " << node << " and " << *current << std::endl;
+                        std::cout << BWAPI::Broodwar->getFrameCount() << ": Loop between " << node << " and " << current << std::endl;
                         return false;
                     }
 
-                    if (!Map::isWalkable(current->x, current->y))
+                    if (!Map::isWalkable(current.x(), current.y()))
                     {
-                        std::cout << BWAPI::Broodwar->getFrameCount() << ": Path from " << node << " goes through unwalkable tile " << *current
+                        std::cout << BWAPI::Broodwar->getFrameCount() << ": Path from " << node << " goes through unwalkable tile " << current
                                   << std::endl;
                         return false;
                     }
 
-                    current = current->nextNode;
+                    current = current.nextNode();
                     i++;
                 }
             }
@@ -109,6 +112,7 @@ namespace
             PathFinding::initializeGrids();
 
             grid = new NavigationGrid(goal, BWAPI::UnitTypes::Protoss_Nexus.tileSize());
+            grid->update();
             EXPECT_TRUE(validateGrid(*grid));
         };
 
@@ -160,6 +164,54 @@ TEST(InitializeNavigationGrid, OurPosition)
     test.run();
 }
 
+// Tests that a grid loaded from the map data cache is identical to the built grid
+TEST(InitializeNavigationGrid, MapDataCache)
+{
+    BWTest test;
+    NavigationGrid *grid;
+
+    setupGridTest(test, BWAPI::TilePosition(117, 7), grid);
+
+    test.onFrameMine = [&]()
+    {
+        if (BWAPI::Broodwar->getFrameCount() == 1)
+        {
+            // Start without a cache file, in case an earlier run left one behind
+            auto cacheFile = (std::ostringstream() << "bwapi-data/write/" << BWAPI::Broodwar->mapHash() << "_mapDataCache.bin").str();
+            std::filesystem::remove(cacheFile);
+            MapDataCache::initialize();
+
+            NavigationGrid built(grid->goal, grid->goalSize());
+            built.update();
+            EXPECT_FALSE(built.loadedFromCache);
+
+            // Simulate the next game on the same map
+            MapDataCache::write();
+            MapDataCache::initialize();
+
+            NavigationGrid cached(grid->goal, grid->goalSize());
+            cached.update();
+            EXPECT_TRUE(cached.loadedFromCache);
+            EXPECT_TRUE(validateGrid(cached));
+
+            for (int y = 0; y < BWAPI::Broodwar->mapHeight(); y++)
+            {
+                for (int x = 0; x < BWAPI::Broodwar->mapWidth(); x++)
+                {
+                    EXPECT_EQ(built[BWAPI::TilePosition(x, y)].cost(), cached[BWAPI::TilePosition(x, y)].cost());
+                }
+            }
+
+            std::filesystem::remove(cacheFile);
+            MapDataCache::initialize();
+        }
+
+        CherryVis::frameEnd(BWAPI::Broodwar->getFrameCount());
+    };
+
+    test.run();
+}
+
 // Tests that adding a pylon to the grid works
 TEST(UpdateNavigationGrid, Pylon)
 {
@@ -432,7 +484,7 @@ TEST(UpdateNavigationGrid, PylonEmpireOfTheSun)
 
             grid->update();
             EXPECT_TRUE(validateGrid(*grid));
-            EXPECT_TRUE((*grid)[BWAPI::TilePosition(118, 122)].cost < USHRT_MAX);
+            EXPECT_TRUE((*grid)[BWAPI::TilePosition(118, 122)].cost() < USHRT_MAX);
         }
 
         CherryVis::frameEnd(BWAPI::Broodwar->getFrameCount());
@@ -504,7 +556,7 @@ TEST(UpdateNavigationGrid, HeartbreakRidgeBug)
 
             grid->update();
             EXPECT_TRUE(validateGrid(*grid));
-            EXPECT_TRUE((*grid)[BWAPI::TilePosition(32, 70)].cost < USHRT_MAX);
+            EXPECT_TRUE((*grid)[BWAPI::TilePosition(32, 70)].cost() < USHRT_MAX);
         }
 
         CherryVis::frameEnd(BWAPI::Broodwar->getFrameCount());
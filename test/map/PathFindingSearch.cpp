@@ -5,6 +5,8 @@
 #include "Players.h"
 #include "Map.h"
 
+#include <thread>
+
 TEST(PathFindingSearch, FindPath_NonOptimalWhenDiagonal)
 {
     BWTest test;
@@ -90,3 +92,125 @@ TEST(PathFindingSearch, FindPath_Profiling)
 
     test.run();
 }
+
+TEST(PathFindingSearch, FindPath_JumpPointSearch)
+{
+    BWTest test;
+    test.opponentModule = []()
+    {
+        return new DoNothingModule();
+    };
+    test.map = Maps::GetOne("Fighting Spirit");
+    test.randomSeed = 42;
+    test.frameLimit = 10;
+    test.expectWin = false;
+    test.writeReplay = false;
+
+    test.onStartMine = []()
+    {
+        auto isWalkableTile = [](BWAPI::TilePosition tile)
+        {
+            return Map::isWalkable(tile);
+        };
+
+        TileBitset walkableTiles(BWAPI::Broodwar->mapWidth(), BWAPI::Broodwar->mapHeight());
+        for (int y = 0; y < BWAPI::Broodwar->mapHeight(); y++)
+        {
+            for (int x = 0; x < BWAPI::Broodwar->mapWidth(); x++)
+            {
+                walkableTiles.set(x, y, Map::isWalkable(x, y));
+            }
+        }
+
+        auto pathCost = [](BWAPI::TilePosition start, const std::vector<BWAPI::TilePosition> &path)
+        {
+            int cost = 0;
+            auto current = start;
+            for (const auto &tile : path)
+            {
+                EXPECT_LE(std::abs(tile.x - current.x), 1);
+                EXPECT_LE(std::abs(tile.y - current.y), 1);
+                EXPECT_TRUE(Map::isWalkable(tile));
+                cost += (tile.x != current.x && tile.y != current.y) ? 14 : 10;
+                current = tile;
+            }
+            return cost;
+        };
+
+        std::vector<std::pair<BWAPI::TilePosition, BWAPI::TilePosition>> startsAndEnds = {
+                {BWAPI::TilePosition(BWAPI::WalkPosition(453, 384)), BWAPI::TilePosition(BWAPI::WalkPosition(420, 408))},
+                {BWAPI::TilePosition(118, 122), BWAPI::TilePosition(117, 88)},
+                {BWAPI::TilePosition(117, 7), BWAPI::TilePosition(7, 117)},
+        };
+        for (const auto &[start, end] : startsAndEnds)
+        {
+            auto path = PathFinding::Search(start, end, isWalkableTile);
+            auto jpsPath = PathFinding::Search(start, end, walkableTiles);
+            EXPECT_FALSE(jpsPath.empty());
+            if (path.empty() || jpsPath.empty()) continue;
+
+            EXPECT_EQ(jpsPath.back(), end);
+            EXPECT_LE(pathCost(start, jpsPath), pathCost(start, path));
+        }
+    };
+
+    test.run();
+}
+
+TEST(PathFindingSearch, FindPath_SeparateContexts)
+{
+    BWTest test;
+    test.opponentModule = []()
+    {
+        return new DoNothingModule();
+    };
+    test.map = Maps::GetOne("Fighting Spirit");
+    test.randomSeed = 42;
+    test.frameLimit = 10;
+    test.expectWin = false;
+    test.writeReplay = false;
+
+    test.onStartMine = []()
+    {
+        auto isWalkableTile = [](BWAPI::TilePosition tile)
+        {
+            return Map::isWalkable(tile);
+        };
+
+        // Searches in their own contexts on other threads should give the same paths as searches on the frame thread
+        auto expected = PathFinding::Search(BWAPI::TilePosition(118, 122), BWAPI::TilePosition(117, 88), isWalkableTile);
+        EXPECT_FALSE(expected.empty());
+
+        int mapWidth = BWAPI::Broodwar->mapWidth();
+        int mapHeight = BWAPI::Broodwar->mapHeight();
+        std::vector<std::vector<BWAPI::TilePosition>> paths(4);
+        std::vector<std::thread> threads;
+        for (auto &path : paths)
+        {
+            threads.emplace_back([&path, &isWalkableTile, mapWidth, mapHeight]()
+                                 {
+                                     PathFinding::SearchContext context(mapWidth, mapHeight);
+                                     for (int i = 0; i < 10; i++)
+                                     {
+                                         path = PathFinding::Search(BWAPI::TilePosition(118, 122),
+                                                                    BWAPI::TilePosition(117, 88),
+                                                                    isWalkableTile,
+                                                                    nullptr,
+                                                                    500,
+                                                                    &context);
+                                     }
+                                 });
+        }
+        for (auto &thread : threads)
+        {
+            thread.join();
+        }
+
+        for (auto &path : paths)
+        {
+            EXPECT_EQ(path, expected);
+        }
+    };
+
+    test.run();
+}